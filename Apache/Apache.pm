@@ -390,6 +390,16 @@ The $r-E<gt>filename method will return the result of the I<URI --E<gt>
 filename> translation, optionally changing it with the first argument
 if you happen to be doing the translation.
 
+=item $r-E<gt>slurp_filename( [$readonly] )
+
+Returns a reference to a scalar holding the contents of
+$r-E<gt>filename.  With a true argument, where Apache is built with
+USE_MMAP_FILES, large files are mapped rather than copied and the
+scalar is read-only.  This is meant for code which is compiled and
+then dropped, as B<Apache::Registry> does: the scalar must not be
+kept, since the process gets a SIGBUS if the file is truncated while
+it is mapped.
+
 =item $r-E<gt>location
 
 The $r-E<gt>location method will return the path of the
@@ -1163,6 +1173,60 @@ The I<post_connection> method is simply an alias for I<register_cleanup>,
 as this method may be used to run code after the client connection is closed,
 which may not be a I<cleanup>.
 
+=item Apache-E<gt>mem_counters
+
+Returns the number of SVs currently allocated and, with glibc, the
+number of bytes of heap in use, as used by B<Apache::LoadProfile>.
+
+=item Apache-E<gt>maintenance( [$every] )
+
+Turns on a maintenance stage run after every C<$every> requests, once
+the response has been flushed to the client.  It runs the deferred
+cleanups (see below), shrinks Perl's temporaries stack back down and,
+with glibc, calls malloc_trim() to hand free heap back to the system.
+Children fragmented by a few large requests then stop looking bigger
+to B<Apache::SizeLimit> than they really are.  0, the default, turns
+the stage off.  Returns the previous setting.
+
+   #startup.pl
+   Apache->maintenance(50);
+
+=item Apache-E<gt>defer_cleanup($code_ref)
+
+Queues C<$code_ref> to run, without arguments, during the next
+maintenance run, or at the end of the current request if the
+maintenance stage is off.  Useful for work such as pruning caches
+which need not happen while a request is being served.
+
+=item Apache-E<gt>maintenance_stats
+
+Returns a hash reference with the number of maintenance C<runs> in
+this child, the time they took in C<usecs>, the resident memory they
+gave back in C<bytes> (linux only), the number of C<deferred> cleanups
+run and the current C<interval>.
+
+=item Apache-E<gt>tmp_arena( [$on] )
+
+Turns on recycling of the small C structures mod_perl allocates for
+each tied table (C<$r-E<gt>headers_in> and friends), B<Apache::URI>
+object and B<Apache::File> parse.  Freed structures are kept and
+handed out again rather than going back to malloc, and anything past
+a small reserve is released in bulk at the end of each request.  Off
+by default, returns the previous setting.
+
+This is a free list per structure size, not a true per-request arena:
+B<Apache::URI> objects and tied tables may be stored in globals and
+outlive the request that made them, so their memory cannot be
+reclaimed wholesale when the request pool is cleared.  Each structure
+is still freed individually by its DESTROY.
+
+=item Apache-E<gt>tmp_arena_stats
+
+Returns a hash reference with the number of allocations served from
+the recycled structures (C<hits>), those which had to call malloc
+(C<misses>), the number C<released> at the end of requests and the
+number currently C<cached>.
+
 =back
 
 =head1 CGI SUPPORT
@@ -1221,9 +1285,8 @@ send to the error_log if B<LogLevel> is set to B<warn> or higher.
   $unescaped_url = Apache::unescape_url($string)
 
 Handy function for unescapes.  Use this one for
-filenames/paths. Notice that the original C<$string> is mangled in the
-process (because the string part of PV shrinks, but the variable is
-not updated, to speed things up).
+filenames/paths. Notice that the original C<$string> is unescaped in
+place as well, to save a copy when the argument is not needed anymore.
 
 Use unescape_url_info for the result of submitted form data.
 
@@ -1231,6 +1294,7 @@ Use unescape_url_info for the result of submitted form data.
 
 Handy function for unescapes submitted form data.
 In opposite to unescape_url it translates the plus sign to space.
+The argument is left as it is.
 
 =item Apache::perl_hook($hook)
 
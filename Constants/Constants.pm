@@ -8,12 +8,6 @@ use mod_perl ();
     __PACKAGE__->mod_perl::boot($VERSION);
 }
 
-unless(defined &import) {
-    require Exporter;
-    require Apache::Constants::Exports;
-    *import = \&Exporter::import;
-}
-
 sub autoload {
     if (defined &__AUTOLOAD) { #make extra sure we don't recurse
         #why must we stringify first???
@@ -78,6 +72,24 @@ Server constants used by apache modules are defined in
 B<httpd.h> and other header files, this module gives Perl access
 to those constants. 
 
+All of the constants are created as constant subroutines when the
+module is loaded, and B<import> is written in C, without
+B<Exporter>.  Besides the tags below, constants may be imported by
+name.  B<%EXPORT_TAGS> and B<@EXPORT_OK> are only set up once
+B<Apache::Constants::Exports> has been loaded.
+
+The constants are imported into the package of the statement which
+calls B<import>, unlike B<Exporter> there is no I<ExportLevel>.  A
+module which passes its own import on to this one should do so from
+the package the constants are meant for, rather than with
+C<goto &Apache::Constants::import>:
+
+ sub import {
+     my $class = shift;
+     my $pkg = caller;
+     eval "package $pkg; Apache::Constants->import(\@_)";
+ }
+
 =head1 EXPORT TAGS
 
 =over 4
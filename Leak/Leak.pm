@@ -55,6 +55,46 @@ sub handler {
     0;
 }
 
+#PerlCleanupHandler Apache::Leak::sample_handler
+sub sample_handler {
+    my $r = shift;
+    unless (sample_ticks()) {
+	sample_start($r->dir_config('LeakSampleRate') || 16,
+		     int rand 2**31);
+    }
+    sample_tick($r->uri);
+    0;
+}
+
+sub status_leak {
+    my($r, $q) = @_;
+    my $window = $r->dir_config('LeakSampleWindow') || 10;
+    my $report = sample_report($window);
+    my @retval = ("<p>SVs in process $$ which survived $window ",
+		  "samples (", sample_ticks(), " taken so far)</p>\n");
+
+    unless (%$report) {
+	push @retval, "No suspects", sample_ticks() ? "" :
+	  ", enable with <code>PerlCleanupHandler ".
+	  "Apache::Leak::sample_handler</code>";
+	return \@retval;
+    }
+
+    push @retval, "<table border=1>",
+      "<tr><td><b>Type</b></td><td><b>First seen</b></td>",
+      "<td><b>Count</b></td></tr>\n";
+    for (sort { $report->{$b} <=> $report->{$a} } keys %$report) {
+	my($type, $site) = split /\t/;
+	push @retval,
+	  "<tr><td>$type</td><td>$site</td><td>$report->{$_}</td></tr>\n";
+    }
+    push @retval, "</table>\n";
+    \@retval;
+}
+
+Apache::Status->menu_item(leak => "Sampled SV Leaks", \&status_leak)
+  if defined &Apache::module and Apache->module("Apache::Status");
+
 1;
 __END__
 
@@ -76,6 +116,36 @@ Apache::Leak - Module for tracking memory leaks in mod_perl code
 
 "Under Construction."
 
+=head1 SAMPLING
+
+C<leak_test> and C<handler> remember every SV in the process, which
+is far too slow for a production server.  Instead, a sampling mode can
+be left on:
+
+ PerlModule Apache::Status
+ PerlModule Apache::Leak
+ PerlCleanupHandler Apache::Leak::sample_handler
+ PerlSetVar LeakSampleRate 16
+ PerlSetVar LeakSampleWindow 10
+
+After each request, only the SV arenas picked by a per-child random
+seed, about one in I<LeakSampleRate> (default 16), are walked.  Each
+live SV is remembered along with the uri of the first request after
+which it was seen.  An SV still alive I<LeakSampleWindow> (default
+10) requests later is a suspect.  The I<Sampled SV Leaks> menu item of
+B<Apache::Status> counts suspects by type (or class, for objects) and
+by the uri which created them.  The lowest numbers are the most
+interesting, since caches and other long-lived data show up here too.
+
+Perl has no hook for SV allocation, so suspects are attributed to the
+request after which they first appeared, not to a line of code.  A
+freed SV whose slot is reused by an SV of the same type counts as a
+survivor, so treat the counts as hints.
+
+The same can be driven by hand with C<sample_start($rate, $seed)>,
+C<sample_tick($site)>, C<sample_report($window)> (a hash reference of
+C<"type\tsite"> to count), C<sample_ticks()> and C<sample_stop()>.
+
 =head1 SEE ALSO
 
 Devel::Leak
@@ -17,6 +17,10 @@
 #define PL_sv_arenaroot sv_arenaroot
 #endif
 
+#ifndef HvNAME_get
+#define HvNAME_get(hv) HvNAME(hv)
+#endif
+
 typedef long used_proc _((void *, SV *, long));
 typedef struct hash_s *hash_ptr;
 
@@ -148,6 +152,219 @@ static long check_used(hash_ptr **x) {
     return count;
 }
 
+/*
+ * sampling mode, cheap enough to leave on in production:
+ * only arenas picked by a seeded hash of their address are walked,
+ * so the same ~1/rate of the SVs are looked at on every tick.
+ * live SVs go in an open addressing table along with the tick they
+ * were first seen and the "site" (normally the uri) of that tick.
+ * an SV still there window ticks later is a suspect.  a freed slot
+ * reused by an SV of the same type looks like a survivor, which is
+ * why this only gives suspects.
+ */
+
+typedef struct {
+    SV *sv;
+    U32 born;
+    U16 site;
+    U16 type;
+} sample_ent;
+
+typedef struct {
+    sample_ent *ents;
+    UV size; /* always a power of 2 */
+    UV used;
+} sample_tab;
+
+#define MAX_SITES 1024
+
+static sample_tab sample = {NULL, 0, 0};
+static sample_tab spare = {NULL, 0, 0}; /* the last tick's, reused */
+static UV sample_rate = 0, sample_seed = 0;
+static U32 sample_ticks = 0;
+static char *sites[MAX_SITES];
+static U16 nsites = 0;
+
+#define SAMPLE_HASH(p) \
+ ((((UV)(p) >> 4) * (UV)2654435761U) ^ sample_seed)
+
+#define ARENA_SAMPLED(sva) \
+ ((sample_rate <= 1) || ((SAMPLE_HASH(sva) >> 3) % sample_rate) == 0)
+
+static void sample_insert(sample_tab *tab, SV *sv, U32 born, U16 site, U16 type);
+
+static void sample_grow(sample_tab *tab)
+{
+    sample_tab big;
+    UV i;
+
+    big.size = tab->size ? tab->size * 2 : 1024;
+    big.used = 0;
+    Newz(603, big.ents, big.size, sample_ent);
+
+    for (i = 0; i < tab->size; i++) {
+	sample_ent *e = &tab->ents[i];
+	if (e->sv)
+	    sample_insert(&big, e->sv, e->born, e->site, e->type);
+    }
+    Safefree(tab->ents);
+    *tab = big;
+}
+
+static sample_ent *sample_find(sample_tab *tab, SV *sv)
+{
+    UV i;
+
+    if (!tab->size)
+	return NULL;
+
+    for (i = SAMPLE_HASH(sv) & (tab->size - 1); tab->ents[i].sv;
+	 i = (i + 1) & (tab->size - 1))
+    {
+	if (tab->ents[i].sv == sv)
+	    return &tab->ents[i];
+    }
+    return NULL;
+}
+
+static void sample_insert(sample_tab *tab, SV *sv, U32 born, U16 site, U16 type)
+{
+    UV i;
+
+    if ((tab->used + 1) * 2 > tab->size)
+	sample_grow(tab);
+
+    for (i = SAMPLE_HASH(sv) & (tab->size - 1); tab->ents[i].sv;
+	 i = (i + 1) & (tab->size - 1))
+	;
+    tab->ents[i].sv   = sv;
+    tab->ents[i].born = born;
+    tab->ents[i].site = site;
+    tab->ents[i].type = type;
+    tab->used++;
+}
+
+/* site 0 is for SVs which were there before sampling started */
+static U16 site_index(char *site)
+{
+    U16 i;
+    for (i = 0; i < nsites; i++) {
+	if (*sites[i] == *site && strEQ(sites[i], site))
+	    return i;
+    }
+    if (nsites == MAX_SITES)
+	return MAX_SITES - 1;
+    sites[nsites] = strdup(nsites == MAX_SITES - 1 ? "(other)" : site);
+    return nsites++;
+}
+
+static void sample_reset(void)
+{
+    U16 i;
+    Safefree(sample.ents);
+    sample.ents = NULL;
+    sample.size = sample.used = 0;
+    Safefree(spare.ents);
+    spare.ents = NULL;
+    spare.size = spare.used = 0;
+    sample_ticks = 0;
+    for (i = 0; i < nsites; i++)
+	free(sites[i]);
+    nsites = 0;
+}
+
+/* walk the sampled arenas, returns the number of live SVs seen */
+static UV sample_tick(char *site)
+{
+    sample_tab next = spare;
+    U16 here;
+    UV n = 0;
+    SV *sva;
+
+    if (!sample_ticks++)
+	(void)site_index("(before sampling)");
+    here = site_index(site);
+
+    /* the population changes little between ticks, so start at its size */
+    if (next.size < sample.size || next.size > sample.size * 4) {
+	Safefree(next.ents);
+	next.ents = NULL;
+	if ((next.size = sample.size))
+	    Newz(603, next.ents, next.size, sample_ent);
+    }
+    else if (next.size) {
+	Zero(next.ents, next.size, sample_ent);
+    }
+    next.used = 0;
+
+    for (sva = PL_sv_arenaroot; sva; sva = (SV *) SvANY(sva)) {
+	SV *sv = sva + 1;
+	SV *svend = &sva[SvREFCNT(sva)];
+
+	if (!ARENA_SAMPLED(sva))
+	    continue;
+
+	for (; sv < svend; ++sv) {
+	    sample_ent *e;
+	    U16 type = SvTYPE(sv);
+
+	    if (type == SVTYPEMASK)
+		continue;
+	    ++n;
+	    if ((e = sample_find(&sample, sv)) && (e->type == type))
+		sample_insert(&next, sv, e->born, e->site, type);
+	    else if (sample_ticks == 1)
+		sample_insert(&next, sv, 0, 0, type);
+	    else
+		sample_insert(&next, sv, sample_ticks, here, type);
+	}
+    }
+
+    spare = sample;
+    sample = next;
+    return n;
+}
+
+static char *sv_type_name(SV *sv)
+{
+    char *name;
+
+    if (SvOBJECT(sv) && SvSTASH(sv) && (name = HvNAME_get(SvSTASH(sv))))
+	return name;
+
+    switch (SvTYPE(sv)) {
+      case SVt_PVAV: return "ARRAY";
+      case SVt_PVHV: return "HASH";
+      case SVt_PVCV: return "CODE";
+      case SVt_PVGV: return "GLOB";
+      case SVt_PVIO: return "IO";
+      case SVt_PVFM: return "FORMAT";
+      default:       return SvROK(sv) ? "REF" : "SCALAR";
+    }
+}
+
+/* count survivors older than window ticks by type and site */
+static HV *sample_report(U32 window)
+{
+    HV *hv = newHV();
+    UV i;
+
+    for (i = 0; i < sample.size; i++) {
+	sample_ent *e = &sample.ents[i];
+	SV *key, **svp;
+
+	if (!e->sv || !e->born || (sample_ticks - e->born) < window)
+	    continue;
+
+	key = newSVpvf("%s\t%s", sv_type_name(e->sv), sites[e->site]);
+	svp = hv_fetch(hv, SvPVX(key), SvCUR(key), TRUE);
+	sv_setiv(*svp, SvIV(*svp) + 1);
+	SvREFCNT_dec(key);
+    }
+
+    return hv;
+}
+
 MODULE = Apache::Leak	PACKAGE = Apache::Leak
 
 PROTOTYPES: Enable
@@ -177,3 +394,42 @@ void
 check_arenas()
 
 
+
+void
+sample_start(rate=16, seed=0)
+    UV rate
+    UV seed
+
+    CODE:
+    sample_reset();
+    sample_rate = rate;
+    sample_seed = seed;
+
+void
+sample_stop()
+
+    CODE:
+    sample_reset();
+
+UV
+sample_tick(site)
+    char *site
+
+IV
+sample_ticks()
+
+    CODE:
+    RETVAL = sample_ticks;
+
+    OUTPUT:
+    RETVAL
+
+SV *
+sample_report(window=10)
+    U32 window
+
+    CODE:
+    RETVAL = newRV_noinc((SV*)sample_report(window));
+
+    OUTPUT:
+    RETVAL
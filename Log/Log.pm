@@ -45,6 +45,46 @@ and I<ap_log_rerror> routines.
 
 =back
 
+The level is checked before anything else is done with the message,
+so a call below the server's I<LogLevel> costs little more than the
+method call itself.  Messages which are expensive to build can be
+passed as a code reference, which is only called if the message is
+going to be logged:
+
+  $rlog->debug(sub { "request state: " . Dumper($state) });
+
+To skip even the method calls, test the level once:
+
+  my $debug = $r->server->loglevel >= Apache::Log::DEBUG;
+  ...
+  $rlog->debug("got here") if $debug;
+
+C<debug> messages are logged with the file and line of the statement
+which made the call.
+
+=head1 BUFFERING
+
+  Apache::Log->buffer(64 * 1024, 5);
+
+Messages are then formatted into a per-child buffer of the given
+size instead of being written one at a time.  The buffer is written
+to the error log when it is full, when its oldest message is more
+than the given number of seconds old (if not 0), when a message is
+for another virtual host's error log, at the end of each request and
+when the child exits, so messages stay in order.  Messages logged by
+Apache itself are not buffered, so may appear ahead of earlier
+Perl messages.  Messages for syslog are never buffered.  As when
+unbuffered, the first warn or more severe message of a request is
+still saved in its I<error-notes> note.
+C<Apache::Log-E<gt>buffer(0)> writes out and frees the buffer.  Returns
+the previous size.
+
+C<Apache::Log-E<gt>flush> writes the buffer out immediately,
+C<Apache::Log-E<gt>buffer_stats> returns a hash reference with the
+number of buffered C<messages>, the number of C<flushes>, the number
+of messages C<dropped> because they could not be written and the
+number currently C<buffered>.
+
 =head1 AUTHOR
 
 Doug MacEachern
@@ -29,3 +29,32 @@ sub dir_merge {
 
 __END__
 
+
+=head1 NAME
+
+Apache::ModuleConfig - Interface to configuration of Perl directive modules
+
+=head1 SYNOPSIS
+
+ use Apache::ModuleConfig ();
+ my $cfg = Apache::ModuleConfig->get($r);
+
+=head1 MERGE CACHE
+
+Apache merges the per-directory configuration of each module for
+every request, calling C<DIR_MERGE> each time for modules whose
+directives are implemented in Perl.  After
+
+ Apache::ModuleConfig->merge_cache(1);
+
+the object returned by C<DIR_MERGE> for each pair of objects is kept
+for the life of the child and handed out again, so each distinct
+merge runs once per child.  The merged objects are then shared by
+requests, so handlers must not modify them.  Returns the previous
+setting, the cache is off by default and emptied on restart.
+
+C<Apache::ModuleConfig-E<gt>merge_stats> returns a hash reference
+with the number of C<merges> performed, the number of C<hits> served
+from the cache and the number of cached C<entries>.
+
+=cut
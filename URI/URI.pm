@@ -54,6 +54,48 @@ This method is considerably faster than using I<URI::URL>:
    C:  1 secs ( 0.62 usr  0.04 sys =  0.66 cpu)
    Perl:  6 secs ( 6.21 usr  0.08 sys =  6.29 cpu) 
 
+Called on an existing I<Apache::URI> object, the URI is parsed into
+that object, which is returned, rather than into a new one:
+
+    $uri->parse($r, $next_uri);
+
+=item components
+
+Returns all components as a list of name/value pairs, I<scheme>,
+I<hostinfo>, I<user>, I<password>, I<hostname>, I<port>, I<path>,
+I<query>, I<fragment> and I<path_info>:
+
+ my %parts = $uri->components;
+
+The value of each component is made once, when first asked for by
+this or its own method, and kept with the object until the component
+is changed or the URI reparsed.
+
+=item canonical
+
+Normalizes the URI in place and returns the object.  The steps to take
+may be named, by default all but C<query> are:
+
+ slashes   collapse repeated slashes in the path
+ dots      resolve "." and ".." path segments
+ escapes   decode escaped unreserved characters ("%7E" to "~"),
+           uppercase the hex digits of other escapes
+ host      lowercase the scheme and hostname
+ port      drop the port if it is the scheme's default
+ query     sort the query arguments by name, keeping the order of
+           arguments with the same name, dropping empty ones
+
+ my $key = $uri->canonical->unparse;
+ $uri->canonical(qw(slashes dots query));
+
+=item normalize_path
+
+Applies the C<escapes>, C<slashes> and C<dots> steps, or those named,
+to a path.  The argument is changed in place, the result also
+returned.
+
+ Apache::URI::normalize_path(my $path = $r->uri);
+
 =item unparse
 
 This method will join the uri components back into a string version.
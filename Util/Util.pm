@@ -13,7 +13,9 @@ use DynaLoader ();
 *import = \&Exporter::import;
 
 @EXPORT_OK = qw(escape_html escape_uri unescape_uri unescape_uri_info 
-		parsedate ht_time size_string validate_password);
+		parsedate ht_time size_string validate_password
+		encode_base64 encode_base64url decode_base64
+		encode_hex decode_hex encode_qp decode_qp);
 %EXPORT_TAGS = (all => \@EXPORT_OK);
 $VERSION = '1.02';
 
@@ -72,6 +74,14 @@ This function will correctly escape US-ASCII output. If you are using
 a different character set such as UTF8, or need more control on
 the escaping process, use HTML::Entities.
 
+Given a second argument, the result is written into that variable
+instead, reusing its buffer, which may be C<$string> itself:
+
+ Apache::Util::escape_html($html, $html);
+
+Runs of characters which need no escaping are copied in bulk, on x86
+with SSE2 they are found 16 bytes at a time.
+
 =item escape_uri
 
 This function replaces all unsafe characters in the $string with their
@@ -79,6 +89,8 @@ escape sequence and returns the result.
 
  my $esc = Apache::Util::escape_uri($uri);
 
+Like escape_html(), it takes an optional variable to write into.
+
 =item unescape_uri
 
 This function decodes all %XX hex escape sequences in the given URI.
@@ -104,6 +116,34 @@ Example:
  name => 'Fred Flintstone',
  town => 'Bedrock'
 
+=item encode_base64, encode_base64url, decode_base64
+
+Base64 encoding, with the standard alphabet or the URL and filename
+safe one (C<-> and C<_> for C<+> and C</>, no padding), without line
+breaks.  decode_base64 accepts either alphabet, skips whitespace and
+returns undef for other characters.
+
+ my($user, $pass) = split /:/,
+     Apache::Util::decode_base64(substr $auth, 6), 2;
+
+=item encode_hex, decode_hex
+
+Lowercase hex encoding, like C<unpack "H*">.  decode_hex accepts
+either case and returns undef for an odd length or a bad digit.
+
+=item encode_qp, decode_qp
+
+Quoted-printable encoding as in RFC 2045, with C<\n> line breaks and
+lines of at most 76 characters.  decode_qp removes soft line breaks and
+leaves a C<=> not followed by two hex digits as it is.
+
+All of these take an optional second argument, a variable to write the
+result into instead of returning a new string.  It may be the first
+argument itself; decoding then happens in the argument's buffer.
+Should decoding fail, the variable is set to undef.
+
+ Apache::Util::decode_base64($token, $token);
+
 =item parsedate
 
 Parses an HTTP date in one of three standard forms:
@@ -118,6 +158,9 @@ Example:
 
  my $secs = Apache::Util::parsedate($date_str);
 
+The last few dates parsed are remembered, so the same
+I<If-Modified-Since> header sent by many clients is parsed once.
+
 =item ht_time
 
 Format a time string.
@@ -130,6 +173,19 @@ Examples:
 
  my $str = Apache::Util::ht_time(time, "%d %b %Y %T %Z", 0);
 
+An optional fourth argument is a variable to write the string into,
+reusing its buffer:
+
+ Apache::Util::ht_time(time, "%a, %d %b %Y %H:%M:%S %Z", 1, $date);
+
+The last string formatted for each format and I<gmt> pair is
+remembered, so formatting the same second again, as is done for each
+date header of a request, does not call strftime().  Changing the
+B<TZ> environment variable at runtime is not noticed for local times
+already formatted.  Nor is a runtime C<setlocale(LC_TIME, ...)>: day
+and month names (C<%a>, C<%b> and the like) stay in the old locale
+until the second changes.
+
 =item size_string
 
 Converts the given file size into a formatted string. The size
@@ -0,0 +1,241 @@
+package Apache::AccessLog;
+
+use strict;
+use vars qw($VERSION);
+
+$VERSION = '1.00';
+
+my $Magic = "MPAL\001";
+
+sub new {
+    my($class, $file) = @_;
+    local *FH;
+    open FH, $file or die "open $file: $!";
+    binmode FH;
+    my $self = bless {fh => *FH, fields => []}, $class;
+
+    my $head = '';
+    read FH, $head, length $Magic;
+    $self->{binary} = $head eq $Magic;
+    seek FH, 0, 0 unless $self->{binary};
+
+    return $self;
+}
+
+sub fields { @{ shift->{fields} } }
+
+#returns the next record as a hash reference, undef at end of file
+sub next {
+    my $self = shift;
+    my $values;
+
+    while (1) {
+        $values = $self->{binary} ? $self->next_binary : $self->next_text;
+        return undef unless $values;
+        if ($self->{header}) {
+            $self->{fields} = $values;
+            next;
+        }
+        #a text record cut short by a failed write
+        last if @$values == @{ $self->{fields} } or !@{ $self->{fields} };
+    }
+
+    my %rec;
+    @rec{ @{ $self->{fields} } } = @$values;
+    return \%rec;
+}
+
+sub next_text {
+    my $self = shift;
+    my $fh = $self->{fh};
+    defined(my $line = <$fh>) or return undef;
+    chomp $line;
+
+    my @values = map {
+        $_ eq '-' ? undef : do {
+            s/\\(.)/$1 eq 't' ? "\t" : $1 eq 'n' ? "\n" : $1/ge; $_;
+        };
+    } split /\t/, $line, -1;
+
+    $self->{header} = @values && $values[0] eq '#fields:';
+    shift @values if $self->{header};
+
+    return \@values;
+}
+
+sub next_binary {
+    my $self = shift;
+
+    while (1) {
+        my $start = tell $self->{fh};
+        $self->{resynced} = 0;
+        my $values = $self->read_binary;
+        return $values if $values;
+        next if $self->{resynced};
+        #a record cut short by a failed write is followed by a header
+        $self->resync($start + 1) or return undef;
+    }
+}
+
+sub read_binary {
+    my $self = shift;
+    my $fh = $self->{fh};
+    my($head, $buf);
+
+    #a header, the log was reopened
+    read($fh, $head, 4) == 4 or return undef;
+    if ($head eq substr($Magic, 0, 4)) {
+        read($fh, $buf, 1) == 1 and $buf eq substr($Magic, 4) or return undef;
+        read($fh, $head, 4) == 4 or return undef;
+        $self->{header} = 1;
+    }
+    else {
+        $self->{header} = !@{ $self->{fields} };
+    }
+
+    my $len = unpack "N", $head;
+    read($fh, $buf, $len) == $len or return undef;
+
+    #a record cut short ran on into the header written after it
+    my $at = tell($fh) - 4 - $len;
+    my $peek = '';
+    read $fh, $peek, length($Magic) - 1;
+    seek $fh, -length($peek), 1;
+    my $i = index $head . $buf . $peek, $Magic;
+    if ($i >= 0 and $i < 4 + $len) {
+        seek $fh, $at + $i, 0;
+        $self->{resynced} = 1;
+        return undef;
+    }
+
+    my @values;
+    my $pos = 0;
+    while ($pos + 2 <= $len) {
+        my $vlen = unpack "n", substr($buf, $pos, 2);
+        last if $pos + 2 + $vlen > $len;
+        push @values, substr($buf, $pos + 2, $vlen);
+        $pos += 2 + $vlen;
+    }
+
+    return $pos == $len ? \@values : undef;
+}
+
+#seek to the next header at or after $from, false if there is none
+sub resync {
+    my($self, $from) = @_;
+    my $fh = $self->{fh};
+    my $buf = '';
+
+    seek $fh, $from, 0 or return 0;
+    while (read $fh, $buf, 8192, length $buf) {
+        my $i = index $buf, $Magic;
+        if ($i >= 0) {
+            return seek $fh, $from + $i, 0;
+        }
+        my $keep = length($Magic) - 1;
+        $keep = length $buf if $keep > length $buf;
+        $from += length($buf) - $keep;
+        $buf = substr $buf, length($buf) - $keep;
+    }
+    return 0;
+}
+
+#print a log as tab separated text, for use from the command line:
+#perl -MApache::AccessLog -e 'Apache::AccessLog->dump(@ARGV)' access_log.bin
+sub dump {
+    my $class = shift;
+    my @files = @_ ? @_ : @ARGV;
+    local $\ = "\n";
+
+    for my $file (@files) {
+        my $log = $class->new($file);
+        my $fields;
+        while (my $rec = $log->next) {
+            my @fields = $log->fields;
+            my $header = join "\t", @fields;
+            print "#$header" unless defined $fields and $fields eq $header;
+            $fields = $header;
+            print join "\t", map { defined $_ ? $_ : "-" } @$rec{@fields};
+        }
+    }
+}
+
+1;
+
+__END__
+
+=head1 NAME
+
+Apache::AccessLog - Write access log records in C, read them back
+
+=head1 SYNOPSIS
+
+ #startup.pl
+ Apache->access_log("/var/log/httpd/access.bin", "binary",
+                    qw(time duration host status bytes method uri
+                       header_in:User-Agent note:session));
+
+ #later
+ use Apache::AccessLog ();
+ my $log = Apache::AccessLog->new("/var/log/httpd/access.bin");
+ while (my $rec = $log->next) {
+     print "$rec->{uri} $rec->{status}\n";
+ }
+
+ % perl -MApache::AccessLog -e 'Apache::AccessLog->dump(@ARGV)' access.bin
+
+=head1 DESCRIPTION
+
+C<Apache-E<gt>access_log($file, $format, @fields)>, called at server
+startup (it only exists when mod_perl is built with B<PERL_LOG>, the
+default), makes mod_perl write a record for each request in the log
+phase, before any B<PerlLogHandler> runs.  The values are taken
+straight from the request, no Perl code runs.  Records are collected
+in a per-child buffer and written out in batches: when the buffer is
+full, when a request is logged two seconds or more after the oldest
+record in the buffer, and when the child exits.  The age is only
+looked at as requests are logged, so a child which serves no more
+requests keeps its last records until it exits, or until
+C<Apache-E<gt>access_log_flush> is called.  The file is opened for
+appending in the parent.  Each batch is written by a single write()
+and holds only whole records, so the children's records do not mix.
+
+The available fields are C<time> (of the request, in seconds since
+the epoch), C<duration> (in seconds), C<status>, C<bytes>, C<method>,
+C<uri>, C<args>, C<protocol>, C<request> (the request line),
+C<filename>, C<host> (the client's IP address), C<user>, C<vhost>,
+C<pid>, and C<header_in:Name>, C<header_out:Name>, C<note:Name> and
+C<env:Name> for an entry of the request's I<headers_in>,
+I<headers_out> (or I<err_headers_out>), I<notes> or
+I<subprocess_env> table.  As with I<mod_log_config>, C<status>,
+C<bytes> and the tables are those of the final internal redirect.
+
+With the C<text> format, each record is a line of tab separated
+values.  Missing values are written as C<->, tabs, newlines and
+backslashes are escaped with a backslash.  With the C<binary> format,
+each record is a 4 byte length followed by each value as a 2 byte
+length and its bytes, in network byte order, missing values are
+empty.  Either way, a header
+naming the fields is written each time the log is opened.
+
+C<Apache-E<gt>access_log> without arguments closes the log,
+C<Apache-E<gt>access_log_flush> writes out the buffer and
+C<Apache-E<gt>access_log_stats> returns a hash reference with the
+number of C<records> logged, C<writes> made and records C<dropped>
+(too large, or lost to a failed write).  A write which fails part way
+through a record leaves it cut short in the file.  The next batch then
+starts with a new header, so a reader can find its way back to whole
+records.
+
+=head1 READING
+
+C<Apache::AccessLog-E<gt>new($file)> opens a log in either format,
+C<next> returns each record as a hash reference keyed by field name
+and C<fields> the names of the current fields.  Records cut short by a
+failed write are skipped, except in text logs where the cut falls in
+the last value.  In binary logs a record holding the header's magic
+bytes (C<"MPAL\001">) is taken for one cut short, with those that
+follow it up to the next header.
+C<Apache::AccessLog-E<gt>dump(@files)> prints logs as text.
+
+=cut
@@ -0,0 +1,164 @@
+package Apache::LoadProfile;
+
+use strict;
+use Apache ();
+use vars qw($VERSION @Tree $File);
+
+$VERSION = '1.00';
+
+#each node is [name, wall, cpu, svs, heap, [children]]
+@Tree = () unless @Tree;
+$File = $ENV{MOD_PERL_LOAD_PROFILE} unless defined $File;
+
+my $hires = eval { require Time::HiRes; 1 };
+my @stack = ([undef, 0, 0, 0, 0, \@Tree]);
+
+sub now { $hires ? Time::HiRes::time() : time }
+
+sub cpu {
+    my($user, $system) = times;
+    $user + $system;
+}
+
+sub counters {
+    defined &Apache::mem_counters ? Apache->mem_counters : (0, 0);
+}
+
+sub require_file {
+    my $file = shift;
+
+    #require VERSION and files already loaded are not interesting
+    return CORE::require($file)
+      if $file =~ /^v?[\d._]+$/ or $INC{$file};
+
+    my $node = [$file, now(), cpu(), counters(), []];
+    push @{ $stack[-1][5] }, $node;
+    push @stack, $node;
+
+    my $rv = eval { CORE::require($file) };
+    my $err = $@;
+
+    pop @stack;
+    my($svs, $heap) = counters();
+    $node->[1] = now() - $node->[1];
+    $node->[2] = cpu() - $node->[2];
+    $node->[3] = $svs - $node->[3];
+    $node->[4] = $heap - $node->[4];
+
+    write_tree($node) if @stack == 1;
+
+    die $err if $err;
+    return $rv;
+}
+
+sub lines {
+    my($nodes, $depth) = @_;
+    my @lines;
+
+    for my $node (@$nodes) {
+        push @lines, sprintf("%9.1f %9.1f %9d %9d %s%s\n",
+                             $node->[1] * 1000, $node->[2] * 1000,
+                             $node->[3], $node->[4] / 1024,
+                             "  " x $depth, $node->[0]);
+        push @lines, lines($node->[5], $depth + 1);
+    }
+
+    @lines;
+}
+
+sub header {
+    sprintf "%9s %9s %9s %9s %s\n", qw(wall_ms cpu_ms svs heap_kb file);
+}
+
+sub write_tree {
+    my $node = shift;
+    return unless $File and $File ne "1";
+
+    local *FH;
+    open FH, ">>$File" or return;
+    print FH header() if -z $File;
+    print FH lines([$node], 0);
+    close FH;
+}
+
+sub status_loadprof {
+    my($r, $q) = @_;
+    my @top = sort { $b->[1] <=> $a->[1] } @Tree;
+    my @retval = ("<pre>", header());
+
+    for (lines(\@top, 0)) {
+        s/&/&amp;/g; s/</&lt;/g; s/>/&gt;/g;
+        push @retval, $_;
+    }
+    push @retval, "</pre>\n";
+
+    \@retval;
+}
+
+#a require compiled while we were in place keeps calling through
+#CORE::GLOBAL::require, so leave it something cheap to call
+sub plain_require { CORE::require($_[0]) }
+
+my $prev = defined &CORE::GLOBAL::require ? \&CORE::GLOBAL::require : undef;
+
+#startup is over, stop timing each require
+sub restore_require {
+    local $^W = 0; #redefined
+    *CORE::GLOBAL::require = $prev || \&plain_require;
+    return 0; #OK
+}
+
+*CORE::GLOBAL::require = \&require_file;
+
+Apache->push_handlers(PerlChildInitHandler => \&restore_require)
+  if $ENV{MOD_PERL} and Apache->can('push_handlers');
+
+1;
+
+__END__
+
+=head1 NAME
+
+Apache::LoadProfile - Profile the modules loaded at server startup
+
+=head1 SYNOPSIS
+
+ MOD_PERL_LOAD_PROFILE=/tmp/load_profile httpd ...
+
+=head1 DESCRIPTION
+
+When the server is started with B<MOD_PERL_LOAD_PROFILE> set in its
+environment, mod_perl loads this module before any B<PerlRequire> or
+B<PerlModule>.  From then on, each file pulled in with C<require> or
+C<use> is timed, including those loaded by other modules.  For each
+file, the wall clock and CPU time taken, the number of SVs it created
+and how much it grew the heap (with glibc) are recorded.  The numbers
+for a file include everything it loaded in turn.  Wall clock time is
+measured with B<Time::HiRes> when it is installed.
+
+Unless B<MOD_PERL_LOAD_PROFILE> is set to C<1>, it names a file to
+which each top-level load is appended once finished, nested loads
+indented below it:
+
+   wall_ms    cpu_ms       svs   heap_kb file
+    2190.4    2120.0    184311     11520 /usr/local/apache/conf/startup.pl
+     812.7     790.0     71093      4410   My/App.pm
+     403.1     400.0     40112      2208     My/Schema.pm
+
+The same tree, slowest first, is shown by the I<Startup Load Profile>
+menu item of B<Apache::Status>.
+
+Only the server startup is profiled: when each child starts, the
+B<PerlChildInitHandler> this module pushes puts back whatever
+C<CORE::GLOBAL::require> was before it, so requires at request time
+are not timed.
+
+Loading this module from a B<PerlModule> directive instead of the
+environment variable works too, but only files loaded after it are
+seen.
+
+=head1 SEE ALSO
+
+Apache::Status(3)
+
+=cut
@@ -1,8 +1,17 @@
 package Apache::Options;
 use Apache::Constants ();
 @ISA = qw(Apache::Constants);
-*EXPORT = $Apache::Constants::EXPORT_TAGS{options};
-$VERSION = '1.61';
+$VERSION = '1.62';
+
+#the C import exports to the package of the statement calling it,
+#so call it from our caller's package, with :options by default
+sub import {
+    my $class = shift;
+    my $pkg = caller;
+    my @syms = @_ ? @_ : (":options");
+    eval "package $pkg; Apache::Constants->import(\@syms)";
+    die $@ if $@;
+}
 
 1;
 
@@ -188,16 +188,9 @@ sub namespace {
 
     my $script_name = $pr->namespace_from;
 
-    # Escape everything into valid perl identifiers
-    $script_name =~ s/([^A-Za-z0-9_\/])/sprintf("_%02x",unpack("C",$1))/eg;
-
-    # second pass cares for slashes and words starting with a digit
-    $script_name =~ s{
-			  (/+)       # directory
-			  (\d?)      # package's first character
-			 }[
-			   "::" . (length $2 ? sprintf("_%02x",unpack("C",$2)) : "")
-			  ]egx;
+    # Escape everything into valid perl identifiers,
+    # computed once per-child and script
+    $script_name = Apache->script_namespace($script_name);
 
     $Apache::Registry::curstash = $script_name;
  
@@ -255,7 +248,8 @@ sub parse_cmdline {
 	    $prepend .= &{$switches{$_}};
 	}
     }
-    $$code =~ s/^/$prepend/ if $prepend;
+    #$code may be a read-only mapping of the file, copy it
+    $pr->{'code'} = $code = \"$prepend$$code" if $prepend;
     return $code;
 }
 
@@ -284,7 +278,7 @@ sub handler ($$) {
 
     my $package = $pr->namespace;
     my $code = $pr->readscript;
-    $pr->parse_cmdline($code);
+    $code = $pr->parse_cmdline($code);
 
     $pr->set_script_name;
     $pr->chdir_file;
@@ -332,6 +326,10 @@ sub flush_namespace {
     my($self, $package) = @_;
     $package ||= $self->namespace;
 
+    #the C version only resets globs which hold something,
+    #it returns -1 if it finds something it can't deal with
+    return if Apache->flush_namespace($package) >= 0;
+
     no strict 'refs';
     my $tab = \%{$package.'::'};
 
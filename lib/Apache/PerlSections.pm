@@ -46,6 +46,113 @@ sub dump {
     return join "\n", @retval, "1;", "__END__", "";
 }
 
+#caching of <Perl> section results across restarts,
+#see $Apache::Server::PerlSectionCache in perl_config.c
+
+my(%INC_before, @Depends);
+
+sub cache_depends {
+    my $self = shift;
+    push @Depends, @_;
+}
+
+sub cache_file {
+    my($self, $code) = @_;
+    require Digest::MD5;
+    my $dir = $Apache::Server::PerlSectionCache;
+    $dir = Apache->server_root_relative($dir) unless $dir =~ m:^/:;
+    join '/', $dir, "perl-section-" . Digest::MD5::md5_hex($$code) . ".pl";
+}
+
+sub cache_fetch {
+    my($self, $code) = @_;
+    %INC_before = %INC;
+    @Depends = ();
+
+    my $file = eval { $self->cache_file(\$code) } or return undef;
+    local *FH;
+    open FH, $file or return undef;
+    local $_;
+
+    while (<FH>) {
+        last unless s/^\#depends //;
+        chomp;
+        my($dep, $mtime) = split /\t/;
+        my $now = (stat $dep)[9];
+        unless (defined $now and $now == $mtime) {
+            close FH;
+            return undef;
+        }
+    }
+
+    my $cached = defined $_ ? join('', $_, <FH>) : undef;
+    close FH;
+    return $cached;
+}
+
+#Data::Dumper saves code references as sub { "DUMMY" }
+sub has_code {
+    my($self, $data, $seen) = @_;
+    return 0 unless ref $data;
+    return 0 if $seen->{$data}++;
+    return 1 if UNIVERSAL::isa($data, 'CODE');
+
+    my @values = UNIVERSAL::isa($data, 'HASH')  ? values %$data :
+                 UNIVERSAL::isa($data, 'ARRAY') ? @$data :
+                 UNIVERSAL::isa($data, 'REF')   ? $$data : ();
+    for (@values) {
+        return 1 if $self->has_code($_, $seen);
+    }
+    return 0;
+}
+
+sub cache_store {
+    my($self, $code) = @_;
+    my $file = eval { $self->cache_file(\$code) } or return undef;
+
+    my $stab = Devel::Symdump->rnew('Apache::ReadConfig');
+    my %seen;
+    {
+        no strict 'refs';
+        for ([scalars => sub { \${$_[0]} }], [arrays => sub { \@{$_[0]} }],
+             [hashes => sub { \%{$_[0]} }])
+        {
+            my($meth, $ref) = @$_;
+            for my $name ($stab->$meth()) {
+                return undef if $self->has_code($ref->($name), \%seen);
+            }
+        }
+    }
+
+    my(@depends, @require, %seen);
+    for my $dep (@Depends, grep { defined } values %INC) {
+        next if $seen{$dep}++;
+        my $mtime = (stat $dep)[9];
+        push @depends, "#depends $dep\t$mtime\n" if defined $mtime;
+    }
+
+    #modules the section pulled in must be loaded on replay too
+    for (sort keys %INC) {
+        next if exists $INC_before{$_};
+        push @require, "require '$_';\n";
+    }
+
+    #never follow a file or link someone else left in the directory
+    require Fcntl;
+    my $tmp = "$file.$$";
+    local *FH;
+    sysopen FH, $tmp, Fcntl::O_WRONLY()|Fcntl::O_CREAT()|Fcntl::O_EXCL(), 0600
+      or return undef;
+    print FH @depends, "package Apache::ReadConfig;\n", @require,
+      $self->dump;
+    unless (close FH and rename $tmp, $file) {
+        unlink $tmp;
+        return undef;
+    }
+
+    return 1;
+}
+
 1;
 
 __END__
@@ -160,8 +267,72 @@ Example:
 
    require 'httpd_config.pl';
 
+=item add_vhosts
+
+Creates virtual hosts directly from a list of C<[$address =E<gt>
+\%config]> pairs, where each C<%config> takes the same form as a
+value of C<%VirtualHost>.  Nothing is stored in C<%VirtualHost>, the
+server records are created as the list is walked, which is much
+cheaper when generating thousands of hosts.  Errors are not logged,
+instead a hash reference is returned mapping the position in the list
+of each host which had problems to an array reference of its error
+messages:
+
+ <Perl>
+ my @vhosts = map {
+     [ "*:80" => { ServerName   => "$_->{name}.example.com",
+                   DocumentRoot => "/web/$_->{name}" } ]
+ } @sites;
+
+ my $errors = Apache::PerlSections->add_vhosts(\@vhosts);
+ for (sort { $a <=> $b } keys %$errors) {
+     warn "$vhosts[$_][1]{ServerName}: @{ $errors->{$_} }\n";
+ }
+ </Perl>
+
+May only be called while a E<lt>PerlE<gt> section is being read.
+Hosts added this way are not part of the C<dump>, so a section which
+calls C<add_vhosts> is never saved by the section cache described
+below, it runs on every restart.
+
+=item cache_depends
+
+Adds files to those checked by the section cache, see below.
+
 =back
 
+=head1 CACHING
+
+Generating the configuration for thousands of virtual hosts in Perl
+can make each restart take many seconds.  If
+C<$Apache::Server::PerlSectionCache> is set to a directory (relative
+to I<ServerRoot> unless it begins with a slash) before a E<lt>PerlE<gt>
+section is read, mod_perl saves the C<dump> of what the section left
+in the B<Apache::ReadConfig> package.  On the next restart the dump is
+evaluated in place of the section, as long as the section's source is
+unchanged and none of the files in C<%INC> have been modified since.
+Modules the section loaded are loaded again first.  Any other files
+the section reads its configuration from must be named with
+C<cache_depends> so that editing them invalidates the cache:
+
+ #startup.pl
+ $Apache::Server::PerlSectionCache = "logs/perl-sections";
+
+ <Perl>
+ use Apache::PerlSections ();
+ Apache::PerlSections->cache_depends("/etc/httpd/vhosts.db");
+ ...
+ </Perl>
+
+Side effects of the section other than setting configuration
+variables, and the C<cache_depends> call itself, are skipped when
+the dump is used.  Sections which call C<add_vhosts> are not cached,
+nor are those leaving code references (a C<PerlHandler =E<gt> sub
+{...}>, say) in the configuration, which the dump cannot save.  Remove
+the cache files to force the section to run.  The cache directory
+should only be writable by the user the server is started as.
+Requires B<Digest::MD5>.
+
 =head1 SEE ALSO
 
 mod_perl(1), Data::Dumper(3), Devel::Symdump(3)
@@ -1,5 +1,6 @@
 package Apache::Registry;
 use Apache ();
+use Apache::RegistryLRU ();
 #use strict; #eval'd scripts will inherit hints
 use Apache::Constants qw(:common &OPT_EXECCGI);
 
@@ -80,16 +81,9 @@ sub handler {
 	    $script_name = join "", $name, $script_name if $name;
 	}
 
-	# Escape everything into valid perl identifiers
-	$script_name =~ s/([^A-Za-z0-9_\/])/sprintf("_%02x",unpack("C",$1))/eg;
-
-	# second pass cares for slashes and words starting with a digit
-	$script_name =~ s{
-			  (/+)       # directory
-			  (\d?)      # package's first character
-			 }[
-			   "::" . (length $2 ? sprintf("_%02x",unpack("C",$2)) : "")
-			  ]egx;
+	# Escape everything into valid perl identifiers,
+	# computed once per-child and script
+	$script_name = Apache->script_namespace($script_name);
 
 	my $package = "Apache::ROOT$script_name";
 	$Apache::Registry::curstash = $script_name;
@@ -104,10 +98,11 @@ sub handler {
 	    $Apache::Registry->{$package}{'mtime'} <= $mtime
 	   ){
 	    # we have compiled this subroutine already, nothing left to do
+	    Apache::RegistryLRU->hit($package);
  	} else {
 	    $r->log_error("Apache::Registry::handler reading $filename")
 		if $Debug && $Debug & 4;
-	    my $sub = $r->slurp_filename;
+	    my $sub = $r->slurp_filename(1); #released once copied into $eval
 	    $sub = parse_cmdline($$sub);
 
 	    # compile this subroutine into the uniq package name
@@ -141,6 +136,8 @@ sub handler {
             $r->log_error(qq{Compiled package \"$package\" for process $$})
 	       if $Debug && $Debug & 1;
 	    $Apache::Registry->{$package}{'mtime'} = $mtime;
+	    Apache::RegistryLRU->compiled($r, $package, $script_name,
+					  length $sub);
 	}
 
 	my $old_status = $r->status;
@@ -327,6 +324,9 @@ This is more important here than anywhere else!
 Your scripts cannot contain the __END__ or __DATA__ token to terminate
 compilation.
 
+Each child keeps every script it has compiled until it exits, see
+L<Apache::RegistryLRU> to put a bound on the number of scripts cached.
+
 =head1 SEE ALSO
 
 perl(1), mod_perl(3), Apache(3), Apache::Debug(3)
@@ -0,0 +1,207 @@
+package Apache::RegistryLRU;
+
+use strict;
+use Apache ();
+use vars qw($VERSION $MAX_SCRIPTS $MAX_BYTES $TICK %STATS);
+
+$VERSION = '1.00';
+
+$MAX_SCRIPTS ||= 0;
+$MAX_BYTES   ||= 0;
+$TICK        ||= 0;
+
+%STATS = (hits => 0, compiles => 0, evictions => 0) unless %STATS;
+
+sub set_max_scripts {
+    my $class = shift;
+    $MAX_SCRIPTS = shift;
+}
+
+sub set_max_bytes {
+    my $class = shift;
+    $MAX_BYTES = shift;
+}
+
+#called when a cached script is about to be run
+sub hit {
+    my($class, $package) = @_;
+    $STATS{hits}++;
+    $Apache::Registry->{$package}{'atime'} = ++$TICK;
+}
+
+#called once $package has been compiled and stored in $Apache::Registry
+sub compiled {
+    my($class, $r, $package, $curstash, $size) = @_;
+    my $ent = $Apache::Registry->{$package};
+
+    $STATS{compiles}++;
+    $ent->{'atime'}    = ++$TICK;
+    $ent->{'size'}     = $size || 0;
+    $ent->{'curstash'} = $curstash;
+
+    $class->shrink($r, $package) if $MAX_SCRIPTS or $MAX_BYTES;
+}
+
+#evict least recently used scripts until we are within the limits,
+#never touching $keep (the script which is about to run)
+sub shrink {
+    my($class, $r, $keep) = @_;
+    my $cache = $Apache::Registry;
+    return unless ref $cache;
+
+    while (1) {
+        my($victim, $oldest, $bytes, $count);
+
+        for my $package (keys %$cache) {
+            my $ent = $cache->{$package};
+            $count++;
+            $bytes += $ent->{'size'} || 0;
+            next if $package eq $keep;
+            my $atime = $ent->{'atime'} || 0;
+            if (!defined $oldest or $atime < $oldest) {
+                ($victim, $oldest) = ($package, $atime);
+            }
+        }
+
+        last unless $victim;
+        last unless ($MAX_SCRIPTS and $count > $MAX_SCRIPTS) or
+                    ($MAX_BYTES   and $bytes > $MAX_BYTES);
+
+        $class->evict($r, $victim);
+    }
+}
+
+sub evict {
+    my($class, $r, $package) = @_;
+    my $ent = delete $Apache::Registry->{$package} or return;
+
+    $r->log_error("Apache::RegistryLRU: evicting $package from process $$")
+        if $Apache::Registry::Debug && $Apache::Registry::Debug & 1;
+
+    #run the END blocks the script registered when it was compiled
+    $r->run_rgy_endav($ent->{'curstash'}) if $ent->{'curstash'};
+
+    $class->flush_package($package);
+    $STATS{evictions}++;
+}
+
+sub flush_package {
+    my($class, $package) = @_;
+
+    no strict 'refs';
+    my $tab = \%{$package.'::'};
+
+    for my $name (keys %$tab) {
+        next if $name =~ /::$/; #nested packages belong to other scripts
+        my $fullname = join '::', $package, $name;
+        if (defined &$fullname) {
+            if (defined &Apache::Symbol::undef) {
+                Apache::Symbol::undef(\&$fullname);
+            }
+            else {
+                local $^W = 0;
+                undef &$fullname;
+            }
+        }
+        delete $tab->{$name};
+    }
+}
+
+sub stats {
+    my $class = shift;
+    my $cache = $Apache::Registry;
+    my %stats = %STATS;
+    @stats{qw(scripts bytes)} = (0, 0);
+
+    if (ref $cache) {
+        for (values %$cache) {
+            $stats{scripts}++;
+            $stats{bytes} += $_->{'size'} || 0;
+        }
+    }
+
+    \%stats;
+}
+
+sub status_rgylru {
+    my($r, $q) = @_;
+    my $stats = __PACKAGE__->stats;
+    my @retval = "<table border=1>\n";
+
+    for (qw(scripts bytes hits compiles evictions)) {
+        push @retval, "<tr><td>$_</td><td>$stats->{$_}</td></tr>\n";
+    }
+    push @retval,
+      "<tr><td>max scripts</td><td>", $MAX_SCRIPTS || "unlimited",
+      "</td></tr>\n",
+      "<tr><td>max bytes</td><td>", $MAX_BYTES || "unlimited",
+      "</td></tr>\n",
+      "</table>\n";
+
+    \@retval;
+}
+
+Apache::Status->menu_item(rgylru => "Registry Script Cache",
+                          \&status_rgylru)
+  if Apache->module("Apache::Status");
+
+1;
+
+__END__
+
+=head1 NAME
+
+Apache::RegistryLRU - Bound the number of Registry scripts cached per child
+
+=head1 SYNOPSIS
+
+ #in startup.pl
+ use Apache::RegistryLRU ();
+ Apache::RegistryLRU->set_max_scripts(200);
+ Apache::RegistryLRU->set_max_bytes(2_000_000);
+
+=head1 DESCRIPTION
+
+B<Apache::Registry> and B<Apache::RegistryNG> keep every script they
+compile in the child's symbol table until the child exits.  Children
+serving a long tail of URLs keep growing until something like
+B<Apache::SizeLimit> kills them.
+
+With a limit set, each child keeps at most that many scripts
+compiled.  When the limit is exceeded after a compile, the least
+recently run script is dropped: its END blocks are run, its
+subroutines are undefined with B<Apache::Symbol> (if loaded) and its
+package is emptied.  The next request for that script compiles it
+again.
+
+=head1 CONFIGURATION
+
+=over 4
+
+=item set_max_scripts
+
+Maximum number of compiled scripts per child, 0 (the default) means
+no limit.
+
+=item set_max_bytes
+
+Maximum total size of the compiled scripts per child, 0 (the default)
+means no limit.  The size of a script is estimated from the size of
+its source, which is good enough to keep a few huge scripts from
+crowding out many small ones.
+
+=back
+
+=head1 STATISTICS
+
+C<Apache::RegistryLRU-E<gt>stats> returns a hash reference with the
+number of cached C<scripts> and their estimated C<bytes>, along with
+the number of cache C<hits>, C<compiles> and C<evictions> in this
+child.  If B<Apache::Status> is loaded before this module, the same
+numbers are shown under the I<Registry Script Cache> menu item.
+
+=head1 SEE ALSO
+
+Apache::Registry(3), Apache::RegistryNG(3), Apache::Symbol(3)
+
+=cut
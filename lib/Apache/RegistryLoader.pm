@@ -3,7 +3,7 @@ use 5.003_97;
 use mod_perl 1.01;
 use strict;
 use Apache::Registry ();
-use Apache::Constants qw(OPT_EXECCGI);
+use Apache::Constants qw(OK HTTP_OK OPT_EXECCGI);
 @Apache::RegistryLoader::ISA = qw(Apache::Registry);
 $Apache::RegistryLoader::VERSION = '1.91';
 
@@ -56,6 +56,112 @@ sub handler {
     $r->SUPER::handler;
 }
 
+#compile a list of scripts, keeping track of what each one cost
+sub load {
+    my($self, $uri, $filename, $virthost) = @_;
+
+    my $mem  = proc_size();
+    my $time = now();
+    my $rc   = eval { $self->handler($uri, $filename, $virthost) };
+    my $err  = $@;
+    #Apache::Registry hands back our status() when the script compiled
+    my $ok   = !$err && defined $rc && ($rc == OK || $rc == HTTP_OK);
+    $err ||= defined $rc ? "status $rc" : "not found";
+    $time = now() - $time;
+    $mem  = proc_size() - $mem if defined $mem;
+
+    Apache::warn(__PACKAGE__.qq{: failed to compile [$uri]: $err}) 
+	unless $ok;
+
+    push @{ $self->{report} }, {
+	uri  => $uri,
+	file => $filename,
+	time => $time,
+	size => $mem,
+	ok   => $ok,
+    };
+
+    $ok;
+}
+
+#each line: uri [filename [virtual_hostname]], # starts a comment
+sub load_manifest {
+    my($self, $manifest) = @_;
+    my $fh = Apache::gensym(__PACKAGE__);
+    open $fh, $manifest or do {
+	Apache::warn(__PACKAGE__.qq{: Cannot open manifest [$manifest]: $!});
+	return;
+    };
+
+    my $n = 0;
+    while (<$fh>) {
+	s/\#.*//;
+	next unless /\S/;
+	my($uri, $filename, $virthost) = split;
+	$n++ if $self->load($uri, $filename, $virthost);
+    }
+    close $fh;
+
+    $n;
+}
+
+#compile every file matching $glob, mapping $dir to $uri_base
+sub load_glob {
+    my($self, $uri_base, $dir, $glob, $virthost) = @_;
+    $glob ||= "*.pl";
+    $dir =~ s:/+$::;
+    $uri_base =~ s:/+$::;
+
+    my $n = 0;
+    for my $filename (sort glob "$dir/$glob") {
+	next unless -f $filename;
+	(my $uri = $filename) =~ s:^\Q$dir\E:$uri_base:;
+	$n++ if $self->load($uri, $filename, $virthost);
+    }
+
+    $n;
+}
+
+sub report {
+    my($self, %args) = @_;
+    my $by  = $args{sort} || 'time';
+    my $max = $args{max}  || 0;
+
+    my @report = sort { ($b->{$by} || 0) <=> ($a->{$by} || 0) } 
+      @{ $self->{report} || [] };
+    splice @report, $max if $max and @report > $max;
+
+    return @report if wantarray;
+
+    my(@lines, $time, $size);
+    for (@report) {
+	$time += $_->{time};
+	$size += $_->{size} || 0;
+	push @lines, sprintf "%8.3fs %8s KB %s %s\n", $_->{time}, 
+	  defined $_->{size} ? $_->{size} : "?", 
+	  $_->{uri}, $_->{ok} ? "" : "(FAILED)";
+    }
+    unshift @lines, sprintf "%s: %d scripts, %.3fs, %d KB\n", 
+      __PACKAGE__, scalar @report, $time || 0, $size || 0;
+
+    join '', @lines;
+}
+
+my $has_hires = eval { require Time::HiRes };
+
+sub now { $has_hires ? Time::HiRes::time() : time }
+
+#process size in KB, undef when we have no way to find out
+sub proc_size {
+    my $fh = Apache::gensym(__PACKAGE__);
+    open $fh, "/proc/self/status" or return undef;
+    local $_;
+    while (<$fh>) {
+	return $1 if /^VmSize:\s+(\d+)/;
+    }
+    undef;
+}
+
 #override Apache class methods called by Apache::Registry
 #normally only available at request-time via blessed request_rec pointer
 sub slurp_filename {
@@ -78,6 +184,7 @@ sub log_error { shift; die @_ if $@; warn @_; }
 sub allow_options { OPT_EXECCGI } #will be checked again at run-time
 sub clear_rgy_endav {}
 sub stash_rgy_endav {}
+sub run_rgy_endav {}
 sub request {}
 sub seqno {0} 
 sub server { shift }
@@ -165,6 +272,37 @@ this directory.
      }
  }
 
+=head1 PRELOADING MANY SCRIPTS
+
+Scripts compiled by the parent are shared copy-on-write by all the
+children, which then skip the compile on their first request for
+each script.  Whole sets of scripts can be loaded from a manifest or a
+directory, while keeping track of what each one costs:
+
+ my $rl = Apache::RegistryLoader->new;
+
+ #each line: uri [filename [virtual_hostname]], `#' starts a comment
+ $rl->load_manifest(Apache->server_root_relative("conf/scripts.list"));
+
+ #all files matching the glob, mapping the directory to the uri
+ $rl->load_glob("/perl", Apache->server_root_relative("perl-scripts"),
+                "*.pl");
+
+ #the 10 slowest, and the 10 largest scripts
+ print STDERR $rl->report(sort => 'time', max => 10);
+ print STDERR $rl->report(sort => 'size', max => 10);
+
+C<load> compiles a single script, as C<handler> does, but failures
+are logged and recorded instead of being fatal.  For each script the
+wall clock compile time (with B<Time::HiRes> if installed) and the
+growth of the process in KB (from I</proc/self/status>, where
+available) are recorded.  In list context C<report> returns the
+records as hash references with the keys I<uri>, I<file>, I<time>,
+I<size> and I<ok>.
+
+Scripts are compiled one after the other: the parent has a single
+Perl interpreter.
+
 =head1 AUTHORS
 
 Doug MacEachern
@@ -1,6 +1,7 @@
 package Apache::RegistryNG;
 
 use Apache::PerlRun ();
+use Apache::RegistryLRU ();
 use Apache::Constants qw(:common);
 use strict;
 use vars qw($VERSION @ISA);
@@ -46,6 +47,12 @@ sub handler ($$) {
 	my $rc = $pr->compile;
         return $rc if $rc != OK;
 	$pr->set_mtime;
+	Apache::RegistryLRU->compiled($r, $package,
+				      $Apache::Registry::curstash,
+				      length ${ $pr->{'code'} });
+    }
+    else {
+	Apache::RegistryLRU->hit($package);
     }
 
     my $old_status = $r->status;
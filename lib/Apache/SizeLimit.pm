@@ -23,6 +23,9 @@ use vars qw(
     $REQUEST_COUNT
     $START_TIME
     $USE_SMAPS
+    $USE_NATIVE
+    %LAST_SIZE
+    %GROWTH
 );
 
 $VERSION = '0.91-dev';
@@ -31,6 +34,7 @@ __PACKAGE__->set_check_interval(1);
 
 $REQUEST_COUNT          = 1;
 $USE_SMAPS              = 1;
+$USE_NATIVE             = 1;
 
 use constant IS_WIN32 => $Config{'osname'} eq 'MSWin32' ? 1 : 0;
 
@@ -56,6 +60,13 @@ sub set_min_shared_size {
     $MIN_SHARE_SIZE = shift;
 }
 
+use vars qw( $SIZE_CACHE_AGE );
+sub set_size_cache_age {
+    my $class = shift;
+
+    $SIZE_CACHE_AGE = shift;
+}
+
 use vars qw( $CHECK_EVERY_N_REQUESTS );
 sub set_check_interval {
     my $class = shift;
@@ -184,7 +195,10 @@ BEGIN {
 
         *_platform_getppid = \&_linux_getppid;
 
-        if ( eval { require Linux::Smaps } && Linux::Smaps->new($$) ) {
+        if ( defined &Apache::proc_size && (Apache->proc_size)[0] ) {
+            *_platform_check_size = \&_native_size_check;
+        }
+        elsif ( eval { require Linux::Smaps } && Linux::Smaps->new($$) ) {
             *_platform_check_size = \&_linux_smaps_size_check;
         }
         else {
@@ -210,6 +224,40 @@ BEGIN {
     }
 }
 
+# smaps_rollup or statm read in C, see Apache->proc_size
+sub _native_size_check {
+    my $class = shift;
+
+    return __PACKAGE__->_linux_size_check() unless $USE_NATIVE;
+
+    my %size;
+    @size{qw(size shared unshared swap)} =
+        Apache->proc_size($SIZE_CACHE_AGE || 0);
+
+    if (%LAST_SIZE) {
+        $GROWTH{$_} = $size{$_} - $LAST_SIZE{$_} for keys %size;
+    }
+    %LAST_SIZE = %size;
+
+    return ( $size{size}, $size{shared} );
+}
+
+sub status_sizelimit {
+    my($r, $q) = @_;
+    my %size;
+    @size{qw(size shared unshared swap)} = Apache->proc_size;
+
+    my @retval = ("<table border=1>\n",
+      "<tr><th></th><th>KB</th><th>growth since last check</th></tr>\n");
+    for (qw(size shared unshared swap)) {
+        push @retval, "<tr><td>$_</td><td>$size{$_}</td><td>",
+          $GROWTH{$_} || 0, "</td></tr>\n";
+    }
+    push @retval, "</table>\n";
+
+    \@retval;
+}
+
 sub _linux_smaps_size_check {
     my $class = shift;
 
@@ -303,6 +351,10 @@ sub _win32_size_check {
     return ( $size, 0 );
 }
 
+Apache::Status->menu_item(sizelimit => "Process Size",
+                          \&status_sizelimit)
+  if defined &Apache::module && Apache->module("Apache::Status");
+
 sub _perl_getppid { return getppid }
 sub _linux_getppid { return Linux::Pid::getppid() }
 
@@ -473,6 +525,12 @@ Calling this causes C<Apache::SizeLimit> to only check the process
 size every C<$interval> requests. If you want this to affect all
 processes, make sure to call this during server startup.
 
+=item * Apache::SizeLimit->set_size_cache_age($seconds)
+
+With the native linux size check (see L</linux>), a reading younger
+than C<$seconds> is reused rather than read again.  The default, 0,
+reads the sizes on every check.
+
 =back
 
 =head1 SHARED MEMORY OPTIONS
@@ -529,6 +587,22 @@ process.  Further, on multiprocessor systems the access is
 synchronized with spinlocks. Again, you might consider using C<<
 Apache::SizeLimit->set_check_interval() >>.
 
+When running under a mod_perl which provides C<< Apache->proc_size >>,
+neither module is needed: the sizes are read in C from
+F</proc/self/smaps_rollup> (linux 4.14 and above), which has the same
+shared numbers as F</proc/self/smaps> summed up by the kernel, falling
+back to F</proc/self/statm>.  The files are kept open and re-read into
+a static buffer, which makes checking on every request affordable.
+C<< Apache->proc_size >> returns the size, shared, unshared and swap
+sizes in KB, where unshared is the resident memory private to the
+process (C<Private_Clean> plus C<Private_Dirty>, or resident less
+shared from F<statm>).  The maximum unshared size set above is still
+compared with the size less the shared size, as on other platforms.  The growth of each since the previous check is kept in
+C<%Apache::SizeLimit::GROWTH>, and both are shown under the
+I<Process Size> menu item of B<Apache::Status>, if it is loaded first.
+Set C<$Apache::SizeLimit::USE_NATIVE> to 0 to use F</proc/self/statm>
+instead.
+
 =head3 Copy-on-write and Shared Memory
 
 The following example shows the effect of copy-on-write:
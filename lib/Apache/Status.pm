@@ -36,6 +36,8 @@ my(%status) = (
    sig => "Signal Handlers",	       
    myconfig => "Perl Configuration",	       
    hooks => "Enabled mod_perl Hooks",
+   hstats => "Handler Statistics",
+   latency => "Handler Latency",
 );
 
 delete $status{'hooks'} if $mod_perl::VERSION >= 1.9901;
@@ -45,6 +47,14 @@ if($Apache::Server::SaveConfig) {
     $status{"section_config"} = "Perl Section Configuration";
 }
 
+if($ENV{MOD_PERL_COW_REPORT}) {
+    $status{"cow"} = "Preloaded Module Sharing";
+}
+
+if($ENV{MOD_PERL_LOAD_PROFILE}) {
+    $status{"loadprof"} = "Startup Load Profile";
+}
+
 sub menu_item {
     my($self, $key, $val, $sub) = @_;
     $status{$key} = $val;
@@ -182,6 +192,146 @@ sub status_script {
     \@retval;
 }
 
+sub status_cow {
+    my($r,$q) = @_;
+    my @retval = ("<table border=1>",
+		  "<tr>", (map "<td><b>$_</b></td>",
+			   "PerlModule/PerlRequire", "Heap KB",
+			   "Resident KB", "Private KB", "% Private"),
+		  "</tr>\n");
+    for (@{ Apache->cow_report }) {
+	my($name, $size, $resident, $private) = @$_;
+	push @retval, "<tr>", (map "<td>$_</td>",
+			       $name, $size, $resident, $private,
+			       $resident ?
+			       int(100 * $private / $resident) : 0),
+	"</tr>\n";
+    }
+    push @retval, "</table>\n";
+    \@retval;
+}
+
+sub status_loadprof {
+    unless (defined &Apache::LoadProfile::status_loadprof) {
+	return ["Apache::LoadProfile was not loaded at startup\n"];
+    }
+    Apache::LoadProfile::status_loadprof(@_);
+}
+
+#upper bound in ms of the histogram bucket holding the $pct percentile
+sub latency_pct {
+    my($calls, $hist, $pct) = @_;
+    my $want = $calls * $pct / 100;
+    my $seen = 0;
+    for my $b (0..$#$hist) {
+	$seen += $hist->[$b];
+	return 2 ** ($b + 1) / 1000 if $seen >= $want;
+    }
+    return 2 ** @$hist / 1000;
+}
+
+sub status_latency {
+    my($r,$q) = @_;
+
+    unless (Apache->handler_latency_enable) {
+	return ["Handler latency is off, enable with ",
+		"<code>Apache-&gt;handler_latency_enable(1, \$slots)</code>\n"];
+    }
+
+    my $stats = Apache->handler_latency;
+    my $secs = (time - $stats->{since}) || 1;
+    my(%phase, @retval);
+    my @cols = ("Handler", "Calls", "Calls/s", "Errors", "Total s",
+		"Avg ms", "Min ms", "Max ms", "p50 ms", "p95 ms", "p99 ms");
+
+    push @retval, "<p>",
+      ($stats->{shared} ? "All children" : "Process $$"),
+      sprintf(", over the last %d seconds", $secs),
+      ($stats->{dropped} ?
+       ", $stats->{dropped} calls not counted, the table of " .
+       "$stats->{shared} handlers is full" : ""),
+      "</p>\n",
+      "<table border=1>", "<tr>", (map "<td><b>$_</b></td>", @cols),
+      "</tr>\n";
+
+    #where the time goes first
+    for (sort { $b->[4] <=> $a->[4] } @{ $stats->{handlers} }) {
+	my($hook, $name, $calls, $errors, $usecs, $min, $max, $hist) = @$_;
+	next unless $calls; #cleared since
+	my $p = $phase{$hook} ||= [0, 0, 0];
+	$p->[0] += $calls; $p->[1] += $errors; $p->[2] += $usecs;
+
+	push @retval, "<tr><td>$hook $name</td>",
+	  (map "<td>$_</td>",
+	   $calls, sprintf("%.2f", $calls / $secs), $errors,
+	   sprintf("%.1f", $usecs / 1e6),
+	   (map { sprintf "%.2f", $_ } $usecs / $calls / 1000,
+	    $min / 1000, $max / 1000,
+	    map { latency_pct($calls, $hist, $_) } 50, 95, 99)),
+	  "</tr>\n";
+    }
+    push @retval, "</table>\n", "<p>Per phase</p>\n",
+      "<table border=1>", "<tr>",
+      (map "<td><b>$_</b></td>", qw(Phase Calls Calls/s Errors),
+       "Total s", "Avg ms"), "</tr>\n";
+    for (sort keys %phase) {
+	my($calls, $errors, $usecs) = @{ $phase{$_} };
+	push @retval, "<tr><td>$_</td>",
+	  (map "<td>$_</td>", $calls, sprintf("%.2f", $calls / $secs),
+	   $errors, sprintf("%.1f", $usecs / 1e6),
+	   sprintf("%.2f", $usecs / $calls / 1000)),
+	  "</tr>\n";
+    }
+    push @retval, "</table>\n";
+
+    \@retval;
+}
+
+sub status_hstats {
+    my($r,$q) = @_;
+
+    unless (Apache->handler_stats_enable) {
+	return ["Handler statistics are off, enable with ",
+		"<code>Apache-&gt;handler_stats_enable(1)</code>\n"];
+    }
+
+    my(%phase, @retval);
+    my @cols = qw(Calls SVs Objects Heap);
+    my $row = sub {
+	my($name, $calls, @v) = @_;
+	"<tr><td>$name</td><td>$calls</td>",
+	(map { defined $_ ?
+		   sprintf("<td>%d (%.1f)</td>", $_, $calls ? $_/$calls : 0) :
+		   "<td>n/a</td>" } @v),
+	"</tr>\n";
+    };
+
+    my $where = Apache->handler_slots ? "all children" : "process $$";
+    push @retval, "<p>Growth in $where, total (per call)</p>\n",
+      "<table border=1>", "<tr>",
+      (map "<td><b>$_</b></td>", "Handler", @cols, "Max SVs"), "</tr>\n";
+
+    for (sort { $a->[0] cmp $b->[0] or $b->[3] <=> $a->[3] }
+	 @{ Apache->handler_stats })
+    {
+	my($hook, $name, @v) = @$_;
+	my $max = pop @v;
+	$phase{$hook}->[$_] += $v[$_] for grep defined $v[$_], 0..$#v;
+	my @cells = $row->("$hook $name", @v);
+	$cells[-1] = "<td>$max</td></tr>\n";
+	push @retval, @cells;
+    }
+    push @retval, "</table>\n", "<p>Per phase</p>\n",
+      "<table border=1>", "<tr>",
+      (map "<td><b>$_</b></td>", "Phase", @cols), "</tr>\n";
+    for (sort keys %phase) {
+	push @retval, $row->($_, @{ $phase{$_} });
+    }
+    push @retval, "</table>\n";
+
+    \@retval;
+}
+
 my $RegistryCache;
 
 sub registry_cache {
@@ -775,6 +925,81 @@ Default is $ServerRoot/logs/b_graphs
 
 =back
 
+=head1 HANDLER STATISTICS
+
+When switched on, mod_perl keeps, for each Perl*Handler it calls, the
+number of calls and how much the SV count, the blessed object count
+(not available with perl 5.20 and later) and the malloc'ed heap (glibc
+only) grew over those calls.  These are shown, along with totals per
+phase, under the I<Handler Statistics> menu item.  A handler whose SV
+count grows on every call is leaking.  The counters cost two
+C<mallinfo()> calls per handler, so they are off by default.
+
+Given a number of slots at server startup, the counters are kept in a
+shared memory segment made in the parent, each handler of each phase
+taking one slot, so they add up the growth in every child.  Without
+slots, or where anonymous shared mmap() or atomic operations (gcc 4.1
+or later) are not available, they are kept for the child serving the
+page only:
+
+ #startup.pl
+ Apache->handler_stats_enable(1, 512);
+
+C<Apache-E<gt>handler_stats_enable> without an argument returns the
+current setting, C<Apache-E<gt>handler_slots> the number of shared
+slots (0 when per child), C<Apache-E<gt>handler_stats> returns a list
+of C<[phase, handler, calls, svs, objects, heap, max_svs]> array
+references (C<objects> is undef where it is not counted),
+C<Apache-E<gt>handler_stats_clear> resets the counters.
+
+=head1 HANDLER LATENCY
+
+Also when switched on, mod_perl times each Perl*Handler call with a
+monotonic clock, counting calls, errors (a status of 500 or above,
+which includes handlers that died), the total, minimum and maximum
+time, and a histogram of times in powers of two microseconds.  The
+I<Handler Latency> menu item shows these, the slowest handlers by total
+time first, with calls per second and the 50th, 95th and 99th
+percentile estimated from the histogram (as the upper bound of the
+bucket they fall in), along with totals per phase.
+
+The latency counters live in the same shared slots as the handler
+statistics, made by whichever of the two is first enabled with a
+number of slots, and are otherwise kept per child the same way:
+
+ #startup.pl
+ Apache->handler_latency_enable(1, 512);
+
+C<Apache-E<gt>handler_latency> returns a hash reference with the time
+counting started (C<since>), the number of C<shared> slots (0 when
+per child), the number of calls C<dropped> because the slots ran out
+and C<handlers>, a list of C<[phase, handler, calls, errors, usecs,
+min, max, histogram]> array references.
+C<Apache-E<gt>handler_latency_clear> zeroes the counters.
+
+=head1 PRELOADED MODULE SHARING
+
+On linux, if the server is started with B<MOD_PERL_COW_REPORT> set in
+its environment, mod_perl remembers the part of the heap each
+B<PerlModule> and B<PerlRequire> grew in the parent.  A I<Preloaded
+Module Sharing> menu item then shows, for the child serving the
+request, how much of each is resident and how much has become private
+to the child through copy-on-write, as found in
+F</proc/self/pagemap>.  Modules with a high private percentage are the
+ones worth restructuring.  The same numbers are returned by
+C<Apache-E<gt>cow_report> as a list of C<[name, size, resident,
+private]> array references, sizes in KB.
+
+The ranges are only approximate: memory a load gets from malloc's free
+lists or from a separate mmap (very large allocations) is not counted.
+
+=head1 STARTUP LOAD PROFILE
+
+If the server is started with B<MOD_PERL_LOAD_PROFILE> set in its
+environment, the I<Startup Load Profile> menu item shows the time,
+SVs and heap taken by each file loaded during startup, as recorded by
+B<Apache::LoadProfile>.
+
 =head1 PREREQUISITES
 
 The I<Devel::Symdump> module, version B<2.00> or higher.
@@ -362,6 +362,59 @@ static void rwrite_neg_trace(request_rec *r)
 		 r->connection->client->flags & B_EOUT);
 }
 
+#define unescape_hex(c) \
+    ((c) >= 'A' ? (((c) & 0xdf) - 'A') + 10 : ((c) - '0'))
+
+/*
+ * decode %XX (and '+' to ' ' for query strings) in place,
+ * returning the new length.  runs without escapes are skipped with
+ * memchr, invalid escapes are left as they are, like ap_unescape_url
+ */
+static STRLEN unescape_buf(char *s, STRLEN len, int plus)
+{
+    char *end = s + len, *d, *p;
+
+    if (plus) {
+	for (p = s; p < end && *p != '%' && *p != '+'; p++)
+	    ;
+    }
+    else if (!(p = memchr(s, '%', len))) {
+	return len;
+    }
+
+    for (d = p; p < end; ) {
+	char *next;
+
+	if (*p == '+') {
+	    *d++ = ' ';
+	    p++;
+	}
+	else if (*p == '%' && p + 2 < end &&
+		 isxdigit((unsigned char)p[1]) &&
+		 isxdigit((unsigned char)p[2])) {
+	    *d++ = (unescape_hex(p[1]) << 4) + unescape_hex(p[2]);
+	    p += 3;
+	}
+	else if (*p == '%') {
+	    *d++ = *p++;
+	}
+
+	if (plus) {
+	    for (next = p; next < end && *next != '%' && *next != '+'; next++)
+		;
+	}
+	else if (!(next = memchr(p, '%', end - p))) {
+	    next = end;
+	}
+	Move(p, d, next - p, char);
+	d += next - p;
+	p = next;
+    }
+
+    *d = '\0';
+    return d - s;
+}
+
 #define check_auth_type(r) \
     if (!auth_type(r)) { \
         (void)mod_perl_auth_type(r, "Basic"); \
@@ -471,6 +524,11 @@ mod_perl_stash_rgy_endav(r, sv=APACHE_REGISTRY_CURSTASH)
     CODE:
     perl_stash_rgy_endav(r->uri, sv);
 
+void
+mod_perl_run_rgy_endav(r, sv=APACHE_REGISTRY_CURSTASH)
+    Apache     r
+    SV *sv
+
 I32
 mod_perl_define(sv, name)
     SV *sv
@@ -651,19 +709,287 @@ mod_perl_gensym(pack="Apache::Symbol")
     char *pack
 
 SV *
-mod_perl_slurp_filename(r)
+mod_perl_slurp_filename(r, readonly=0)
     Apache r
+    int readonly
 
-char *
+    CODE:
+    RETVAL = readonly ?
+	mod_perl_slurp_filename_ro(r) : mod_perl_slurp_filename(r);
+
+    OUTPUT:
+    RETVAL
+
+SV *
+mod_perl_script_namespace(sv, name)
+    SV *sv
+    SV *name
+
+    PREINIT:
+    STRLEN len;
+    char *pv;
+
+    CODE:
+    pv = SvPV(name, len);
+    RETVAL = newSVsv(mod_perl_script_namespace(pv, len));
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+I32
+mod_perl_flush_namespace(sv, package)
+    SV *sv
+    char *package
+
+    PREINIT:
+    HV *stash;
+
+    CODE:
+    if((stash = gv_stashpv(package, FALSE)))
+        RETVAL = mod_perl_flush_namespace(stash);
+    else
+        RETVAL = 0;
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+void
+mod_perl_proc_size(sv, max_age=0)
+    SV *sv
+    int max_age
+
+    PREINIT:
+    mod_perl_proc_size ps;
+
+    PPCODE:
+    sv = sv; /*-Wall*/
+    if(mod_perl_get_proc_size(&ps, max_age) < 0)
+        XSRETURN_EMPTY;
+    EXTEND(sp, 4);
+    PUSHs(sv_2mortal(newSViv(ps.size)));
+    PUSHs(sv_2mortal(newSViv(ps.shared)));
+    PUSHs(sv_2mortal(newSViv(ps.unshared)));
+    PUSHs(sv_2mortal(newSViv(ps.swap)));
+
+SV *
+mod_perl_cow_report(sv)
+    SV *sv
+
+    CODE:
+    RETVAL = mod_perl_cow_report();
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+int
+mod_perl_handler_stats_enable(sv, on=-1, slots=0)
+    SV *sv
+    int on
+    int slots
+
+    CODE:
+    RETVAL = mod_perl_handler_stats_enable(on, slots);
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+int
+mod_perl_handler_slots(sv)
+    SV *sv
+
+    CODE:
+    RETVAL = mod_perl_handler_slots();
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+SV *
+mod_perl_handler_stats(sv)
+    SV *sv
+
+    CODE:
+    RETVAL = mod_perl_handler_stats_report();
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+void
+mod_perl_handler_stats_clear(sv)
+    SV *sv
+
+    CODE:
+    mod_perl_handler_stats_clear();
+    sv = sv; /*-Wall*/
+
+int
+mod_perl_handler_latency_enable(sv, on=-1, slots=0)
+    SV *sv
+    int on
+    int slots
+
+    CODE:
+    RETVAL = mod_perl_handler_latency_enable(on, slots);
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+SV *
+mod_perl_handler_latency(sv)
+    SV *sv
+
+    CODE:
+    RETVAL = mod_perl_handler_latency_report();
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+void
+mod_perl_handler_latency_clear(sv)
+    SV *sv
+
+    CODE:
+    mod_perl_handler_latency_clear();
+    sv = sv; /*-Wall*/
+
+void
+mod_perl_mem_counters(sv)
+    SV *sv
+
+    PREINIT:
+    long svs, heap;
+
+    PPCODE:
+    mod_perl_mem_counters(&svs, &heap);
+    EXTEND(sp, 2);
+    PUSHs(sv_2mortal(newSViv(svs)));
+    PUSHs(sv_2mortal(newSViv(heap)));
+    sv = sv; /*-Wall*/
+
+#ifdef PERL_LOG
+
+void
+mod_perl_access_log(sv, file=Nullch, format="text", ...)
+    SV *sv
+    char *file
+    char *format
+
+    PREINIT:
+    char **names, *errmsg;
+    int i;
+
+    CODE:
+    sv = sv; /*-Wall*/
+    if(!file) {
+	mod_perl_access_log_close();
+	XSRETURN_EMPTY;
+    }
+    if(strNE(format, "text") && strNE(format, "binary"))
+	croak("access_log format must be `text' or `binary'");
+    names = (char **)safemalloc(sizeof(char *) * (items > 3 ? items-3 : 1));
+    for(i=3; i<items; i++)
+	names[i-3] = SvPV(ST(i),na);
+    errmsg = mod_perl_access_log_open(file, strEQ(format, "binary"),
+				      names, items-3);
+    safefree(names);
+    if(errmsg)
+	croak("access_log %s: %s", file, errmsg);
+
+void
+mod_perl_access_log_flush(sv)
+    SV *sv
+
+    CODE:
+    mod_perl_access_log_flush();
+    sv = sv; /*-Wall*/
+
+SV *
+mod_perl_access_log_stats(sv)
+    SV *sv
+
+    CODE:
+    RETVAL = mod_perl_access_log_stats();
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+#endif
+
+int
+mod_perl_maintenance(sv, every=-1)
+    SV *sv
+    int every
+
+    CODE:
+    RETVAL = mod_perl_maintenance_interval(every);
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+void
+mod_perl_defer_cleanup(sv, cv)
+    SV *sv
+    SV *cv
+
+    CODE:
+    mod_perl_defer_cleanup(cv);
+    sv = sv; /*-Wall*/
+
+SV *
+mod_perl_maintenance_stats(sv)
+    SV *sv
+
+    CODE:
+    RETVAL = mod_perl_maintenance_stats();
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+int
+mod_perl_tmp_arena(sv, on=-1)
+    SV *sv
+    int on
+
+    CODE:
+    RETVAL = mod_perl_tmp_arena(on);
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+SV *
+mod_perl_tmp_arena_stats(sv)
+    SV *sv
+
+    CODE:
+    RETVAL = mod_perl_tmp_stats();
+    sv = sv; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+SV *
 unescape_url(sv)
 SV *sv
 
     INIT:
-    char *string = SvPV_force(sv, PL_na);
+    STRLEN len;
+    char *string = SvPV_force(sv, len);
 
     CODE:
-    unescape_url(string);
-    RETVAL = string;
+    SvCUR_set(sv, unescape_buf(string, len, FALSE));
+    SvSETMAGIC(sv);
+    RETVAL = newSVpvn(string, SvCUR(sv));
 
     OUTPUT:
     RETVAL
@@ -672,37 +998,25 @@ SV *sv
 # Doing our own unscape_url for the query info part of an url
 #
 
-char *
+SV *
 unescape_url_info(url)
-    char *     url
+    SV *url
 
-    CODE:
-    register char * trans = url ;
-    char digit ;
+    PREINIT:
+    STRLEN len;
+    char *string;
 
-    if (!url || !*url) {
+    CODE:
+    if (!SvOK(url)) {
         XSRETURN_UNDEF;
     }
-
-    RETVAL = url;
-
-    while (*url != '\0') {
-        if (*url == '+')
-            *trans = ' ';
-	else if (*url != '%')
-	    *trans = *url;
-        else if (!isxdigit(url[1]) || !isxdigit(url[2]))
-            *trans = '%';
-        else {
-            url++ ;
-            digit = ((*url >= 'A') ? ((*url & 0xdf) - 'A')+10 : (*url - '0'));
-            url++ ;
-            *trans = (digit << 4) +
-		(*url >= 'A' ? ((*url & 0xdf) - 'A')+10 : (*url - '0'));
-        }
-        url++, trans++ ;
+    RETVAL = newSVsv(url);
+    string = SvPV_force(RETVAL, len);
+    if (!len) {
+        SvREFCNT_dec(RETVAL);
+        XSRETURN_UNDEF;
     }
-    *trans = '\0';
+    SvCUR_set(RETVAL, unescape_buf(string, len, TRUE));
 
     OUTPUT:
     RETVAL
@@ -2160,3 +2474,22 @@ run(r, allow_send_header=0)
     OUTPUT:
     RETVAL
 
+MODULE = Apache  PACKAGE = Apache::PerlSections
+
+SV *
+add_vhosts(self, list)
+    SV *self
+    SV *list
+
+    CODE:
+    self = self; /*-Wall*/
+    if(!SvROK(list) || (SvTYPE(SvRV(list)) != SVt_PVAV))
+	croak("usage: Apache::PerlSections->add_vhosts(\\@list)");
+#ifdef PERL_SECTIONS
+    RETVAL = perl_section_add_vhosts((AV*)SvRV(list));
+#else
+    croak("add_vhosts: mod_perl built without <Perl> section support");
+#endif
+
+    OUTPUT:
+    RETVAL
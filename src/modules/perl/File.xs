@@ -57,7 +57,7 @@ typedef struct {
 
 AFparsed *ApacheFile_parse(SV *fname, SV *pattern)
 {
-    AFparsed *afp = (AFparsed *)safemalloc(sizeof(AFparsed));
+    AFparsed *afp = (AFparsed *)mod_perl_tmp_alloc(sizeof(AFparsed));
     regexp *re;
     PMOP pm;
     STRLEN len;
@@ -167,7 +167,7 @@ parse(self, filename, pattern)
     sv_setpvf(par, "%c%_%c", '(', pattern, ')');
     afp = ApacheFile_parse(base, par);
     EXTEND(sp, 3); PUSHs(afp->base); PUSHs(path); PUSHs(afp->ext);
-    safefree(afp); SvREFCNT_dec(base); SvREFCNT_dec(par);
+    mod_perl_tmp_free(afp, sizeof(AFparsed)); SvREFCNT_dec(base); SvREFCNT_dec(par);
 
 #endif
 
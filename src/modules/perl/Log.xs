@@ -13,7 +13,140 @@ static void perl_cv_alias(char *to, char *from)
     GvCV_set(gp, perl_get_cv(from, TRUE));
 }
 
-static void ApacheLog(int level, SV *sv, SV *msg)
+static server_rec *ApacheLog_server(SV *sv, request_rec **rp)
+{
+    if(SvROK(sv) && sv_isa(sv, "Apache::Log::Request")) {
+	*rp = (request_rec *) SvIV((SV*)SvRV(sv));
+	return (*rp)->server;
+    }
+    else if(SvROK(sv) && sv_isa(sv, "Apache::Log::Server")) {
+	return (server_rec *) SvIV((SV*)SvRV(sv));
+    }
+    else {
+        croak("Argument is not an Apache or Apache::Server object");
+    }
+    return NULL; /*-Wall*/
+}
+
+/*
+ * optional per-child buffer for messages, switched on with
+ * Apache::Log->buffer($size, $seconds).  messages are formatted the way
+ * ap_log_error would and appended in order, the buffer is written out
+ * when full, when it holds a message older than $seconds, when a message
+ * is for a different error log, at the end of the request and when the
+ * child exits.  messages for syslog go straight to ap_log_error, as do
+ * messages too big for the buffer
+ */
+static char *logbuf = NULL;
+static int logbuf_size = 0, logbuf_secs = 0, logbuf_len = 0, logbuf_msgs = 0;
+static time_t logbuf_since = 0;
+static pid_t logbuf_pid = 0;
+static FILE *logbuf_fp = NULL;
+static pool *logbuf_pool = NULL;
+static struct {
+    long messages;
+    long flushes;
+    long dropped;
+} logbuf_stats = {0, 0, 0};
+
+static const char *level_names[] = {
+    "emerg", "alert", "crit", "error", "warn", "notice", "info", "debug"
+};
+
+static void logbuf_flush(void)
+{
+    /* whatever a child inherited is the parent's to write */
+    if(logbuf_len && logbuf_fp && (logbuf_pid == getpid())) {
+	if((fwrite(logbuf, 1, logbuf_len, logbuf_fp) != (size_t)logbuf_len) ||
+	   (fflush(logbuf_fp) != 0))
+	    logbuf_stats.dropped += logbuf_msgs;
+	logbuf_stats.flushes++;
+    }
+    logbuf_len = logbuf_msgs = 0;
+    logbuf_fp = NULL;
+}
+
+static void logbuf_cleanup(void *data)
+{
+    logbuf_flush();
+    logbuf_pool = NULL;
+}
+
+static void logbuf_atexit(void)
+{
+    logbuf_flush();
+}
+
+static int logbuf_append(int lmask, server_rec *s, request_rec *r,
+			 char *file, int line, char *str)
+{
+    char head[MAX_STRING_LEN];
+    int hlen, slen;
+    time_t now;
+
+    if(!logbuf || !s->error_log)
+	return 0;
+
+    hlen = ap_snprintf(head, sizeof(head), "[%s] [%s] ",
+		       ap_get_time(), level_names[lmask]);
+    if(file)
+	hlen += ap_snprintf(head+hlen, sizeof(head)-hlen,
+			    "%s(%d): ", file, line);
+    if(r)
+	hlen += ap_snprintf(head+hlen, sizeof(head)-hlen,
+			    "[client %s] ", r->connection->remote_ip);
+    slen = strlen(str);
+
+    if((s->error_log != logbuf_fp) || 
+       (logbuf_len + hlen + slen + 1 > logbuf_size))
+	logbuf_flush();
+
+    if(hlen + slen + 1 > logbuf_size)
+	return 0; /* will never fit, log it directly */
+
+    now = time(NULL);
+    if(!logbuf_len) {
+	logbuf_since = now;
+	logbuf_pid = getpid();
+    }
+    logbuf_fp = s->error_log;
+
+    Copy(head, logbuf + logbuf_len, hlen, char);
+    logbuf_len += hlen;
+    Copy(str, logbuf + logbuf_len, slen, char);
+    logbuf_len += slen;
+    logbuf[logbuf_len++] = '\n';
+    logbuf_msgs++;
+    logbuf_stats.messages++;
+
+    if(r) {
+	while(r->main)
+	    r = r->main;
+	if(r->pool != logbuf_pool) {
+	    ap_register_cleanup(r->pool, NULL, logbuf_cleanup, ap_null_cleanup);
+	    logbuf_pool = r->pool;
+	}
+    }
+
+    if(logbuf_secs && ((now - logbuf_since) >= logbuf_secs))
+	logbuf_flush();
+
+    return 1;
+}
+
+/* same test ap_log_error makes, notice messages are always logged */
+#define ApacheLog_wanted(s, lmask) \
+    (((lmask) == APLOG_NOTICE) || ((s)->loglevel >= (lmask)))
+
+/*
+ * ap_log_rerror sets error-notes for warnings and worse even when
+ * LogLevel filters the message itself, so those have to get there
+ */
+#define ApacheLog_needed(s, r, lmask) \
+    (((r) && HAVE_LOG_RERROR && ((lmask) <= APLOG_WARNING)) || \
+     ApacheLog_wanted(s, lmask))
+
+static void ApacheLog(int level, server_rec *s, request_rec *r, SV *msg)
 {
  dTHR;
     char *file = NULL;
@@ -21,31 +154,14 @@ static void ApacheLog(int level, SV *sv, SV *msg)
     char *str;
     SV *svstr = Nullsv;
     int lmask = level & APLOG_LEVELMASK;
-    server_rec *s;
-    request_rec *r = NULL;
 
-    if(sv_isa(sv, "Apache::Log::Request") && SvROK(sv)) {
-	r = (request_rec *) SvIV((SV*)SvRV(sv));
-	s = r->server;
-    }
-    else if(sv_isa(sv, "Apache::Log::Server") && SvROK(sv)) {
-	s = (server_rec *) SvIV((SV*)SvRV(sv));
-    }
-    else {
-        croak("Argument is not an Apache or Apache::Server object");
-    }
-
-    if((lmask == APLOG_DEBUG) && (s->loglevel >= APLOG_DEBUG)) {
-	SV *caller;
-	bool old_T = tainting; tainting = FALSE;
-	caller = perl_eval_pv("[ (caller)[1,2] ]", TRUE);
-	tainting = old_T;
-	file = SvPV(*av_fetch((AV *)SvRV(caller), 0, FALSE),na);
-	line = (int)SvIV(*av_fetch((AV *)SvRV(caller), 1, FALSE));
+    if(lmask == APLOG_DEBUG) {
+	/* the statement which called us */
+	file = SvPV(GvSV(CopFILEGV(curcop)),na);
+	line = (int)CopLINE(curcop);
     }
 
-    if((s->loglevel >= lmask) && 
-       SvROK(msg) && (SvTYPE(SvRV(msg)) == SVt_PVCV)) {
+    if(SvROK(msg) && (SvTYPE(SvRV(msg)) == SVt_PVCV)) {
 	dSP;
 	ENTER;SAVETMPS;
 	PUSHMARK(sp);
@@ -60,7 +176,15 @@ static void ApacheLog(int level, SV *sv, SV *msg)
     else
 	str = SvPV(msg,na);
 
-    if(r && HAVE_LOG_RERROR) {
+    if(logbuf && ApacheLog_wanted(s, lmask) &&
+       logbuf_append(lmask, s, r, file, line, str)) {
+	/* as ap_log_rerror would, for ErrorDocuments and error handlers */
+	if(r && (lmask <= APLOG_WARNING) &&
+	   !ap_table_get(r->notes, "error-notes"))
+	    ap_table_setn(r->notes, "error-notes",
+			  ap_escape_html(r->pool, str));
+    }
+    else if(r && HAVE_LOG_RERROR) {
 #if HAVE_LOG_RERROR > 0
 	ap_log_rerror(file, line, APLOG_NOERRNO|level, r, "%s", str);
 #endif
@@ -84,10 +208,15 @@ else { \
     ++SvREFCNT(msgstr); \
 } 
 
-#define MP_AP_LOG(l,s) \
+/* check the level before doing any work for the message */
+#define MP_AP_LOG(l,sv) \
 { \
-join_stack_msg; \
-ApacheLog(l, s, msgstr); \
+request_rec *log_r = NULL; \
+server_rec *log_s = ApacheLog_server(sv, &log_r); \
+if(ApacheLog_needed(log_s, log_r, l)) { \
+    join_stack_msg; \
+    ApacheLog(l, log_s, log_r, msgstr); \
+} \
 }
 
 #define Apache_log_emerg(s) \
@@ -191,6 +320,63 @@ void
 Apache_log_debug(s, ...)
 	SV *s
 
+int
+Apache_log_buffer(self, size=-1, seconds=0)
+    SV *self
+    int size
+    int seconds
+
+    PREINIT:
+    static int atexit_done = 0;
+
+    CODE:
+    RETVAL = logbuf_size;
+    self = self; /*-Wall*/
+    if(size >= 0) {
+	logbuf_flush();
+	if(logbuf) {
+	    safefree(logbuf);
+	    logbuf = NULL;
+	}
+	logbuf_size = size;
+	logbuf_secs = seconds;
+	if(size) {
+	    logbuf = (char *)safemalloc(size);
+	    if(!atexit_done++)
+		atexit(logbuf_atexit);
+	}
+    }
+
+    OUTPUT:
+    RETVAL
+
+void
+Apache_log_flush(self)
+    SV *self
+
+    CODE:
+    self = self; /*-Wall*/
+    logbuf_flush();
+
+SV *
+Apache_log_buffer_stats(self)
+    SV *self
+
+    PREINIT:
+    HV *hv;
+
+    CODE:
+    self = self; /*-Wall*/
+    hv = newHV();
+    hv_store(hv, "messages", 8, newSViv(logbuf_stats.messages), FALSE);
+    hv_store(hv, "flushes",  7, newSViv(logbuf_stats.flushes), FALSE);
+    hv_store(hv, "dropped",  7, newSViv(logbuf_stats.dropped), FALSE);
+    hv_store(hv, "buffered", 8, newSViv(logbuf_msgs), FALSE);
+    RETVAL = newRV_noinc((SV*)hv);
+
+    OUTPUT:
+    RETVAL
+
 MODULE = Apache::Log		PACKAGE = Apache::Server
 
 PROTOTYPES: DISABLE
@@ -233,3 +233,26 @@ limited(parms)
 
     OUTPUT:
     RETVAL
+
+int
+merge_cache(self, on=-1)
+    SV *self
+    int on
+
+    CODE:
+    RETVAL = perl_merge_cache_enable(on);
+    self = self; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
+
+SV *
+merge_stats(self)
+    SV *self
+
+    CODE:
+    RETVAL = perl_merge_cache_stats();
+    self = self; /*-Wall*/
+
+    OUTPUT:
+    RETVAL
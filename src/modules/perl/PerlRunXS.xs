@@ -57,70 +57,6 @@
 
 #include "mod_perl.h"
 
-static const char c2x_table[] = "0123456789abcdef";
-
-static unsigned char *c2x(unsigned what, unsigned char *where)
-{
-    *where++ = '_';
-    *where++ = c2x_table[what >> 4];
-    *where++ = c2x_table[what & 0xf];
-    return where;
-}
-
-/*
- * s/([^A-Za-z0-9\/])/sprintf("_%2x",unpack("C",$1))/eg;
- */
-static char *uri2perlish(char *segment, int slen) {
-    register int x,y;
-    char *copy = (char *)safemalloc(3 * slen + 1);
-
-    for(x=0,y=0; segment[x]; x++,y++) {
-	char c = segment[x];
-	if((c < 'A' || c > 'Z') && (c < 'a' || c > 'z') && (c < '0' || c >'9')
-	   && c != '/')
-        {
-	    c2x(c, &copy[y]);
-	    y += 2;
-        }
-	else
-	    copy[y] = c;
-    }
-    copy[y] = '\0';
-    return copy;
-}
-
-/*
- * s{
- *   (/+)       # directory
- *   (\d?)      # package's first character
- *  }[
- *   "::" . ($2 ? sprintf("_%2x",unpack("C",$2)) : "")
- *   ]egx;
- */
-static SV *slash2stash(const char *segment) {
-    register int x,y;
-    SV *sv = newSV(3 * strlen(segment));
-
-    for(x=0,y=0; segment[x]; x++,y++) {
-	char c=segment[x];
-	if(c == '/') {
-	    SvPVX(sv)[y] = ':';
-	    SvPVX(sv)[++y] = ':';
-	    if(isDIGIT(segment[x+1])) {
-		char d = segment[++x];
-		c2x(d, &SvPVX(sv)[++y]);
-		y += 2;
-	    }
-        }
-	else
-	    SvPVX(sv)[y] = c;
-    }
-    SvPVX(sv)[y] = '\0';
-    SvCUR_set(sv, y);
-    SvPOK_on(sv);
-    return sv;
-}
-
 #define ApachePerlRun_import_exit() \
     "use Apache 'exit';\n"
 
@@ -134,28 +70,29 @@ static SV *slash2stash(const char *segment) {
 
 SV *ApachePerlRun_namespace(request_rec *r, char *root)
 {
-    char *copy, *uri;
-    int uri_len;
-    SV *esc, *RETVAL;
+    char *name;
+    int uri_len = strlen(r->uri);
+    SV *nwvh, *esc, *RETVAL;
 
-    uri = (char *)pstrdup(r->pool, r->uri);
-    uri_len = strlen(uri);  
     if(r->path_info) {
 	int n = strlen(r->path_info);
-	int chop = (uri_len - n);
-	uri[chop] = '\0';
+	if(n <= uri_len && strEQ(r->uri + uri_len - n, r->path_info))
+	    uri_len -= n;
     }
-    if(r->server->is_virtual && ApachePerlRun_name_with_virtualhost()) {
-	uri = pstrcat(r->pool, r->server->server_hostname, uri, NULL);
-	uri_len += strlen(r->server->server_hostname);
+    name = pstrndup(r->pool, r->uri, uri_len);
+
+    if(r->server->is_virtual && 
+       (nwvh = ApachePerlRun_name_with_virtualhost()) && SvTRUE(nwvh)) {
+	name = pstrcat(r->pool, ap_get_server_name(r), name, NULL);
     }
-    copy = uri2perlish(uri, uri_len);
-    RETVAL = newSVpv(root ? root : "Apache::ROOT",0);
-    esc = slash2stash(copy);	
+    if(uri_len && r->uri[uri_len-1] == '/') {
+	name = pstrcat(r->pool, name, "__INDEX__", NULL);
+    }
+
+    esc = mod_perl_script_namespace(name, strlen(name));
     sv_setsv(perl_get_sv("Apache::Registry::curstash", TRUE), esc);
+    RETVAL = newSVpv(root ? root : "Apache::ROOT",0);
     sv_catsv(RETVAL, esc);
-    safefree(copy);
-    SvREFCNT_dec(esc);
     return RETVAL;
 }
 
@@ -208,6 +145,7 @@ void ApachePerlRun_compile(request_rec *r, SV *code_ref)
  */
 
 #define ApachePerlRun_readscript mod_perl_slurp_filename
+#define ApachePerlRun_mapscript mod_perl_slurp_filename_ro
 
 SV *ApachePerlRun_parse_cmdline(request_rec *r, SV *code)
 {
@@ -260,7 +198,7 @@ int handler(request_rec *r)
     ENTER;
     package = ApachePerlRun_namespace(r, NULL);
     SAVEFREESV(package);
-    code = ApachePerlRun_readscript(r);
+    code = ApachePerlRun_mapscript(r);
     SAVEFREESV(code);
     eval = newSV(0);
     SAVEFREESV(eval);
@@ -335,7 +273,7 @@ static int registry_handler(request_rec *r)
     if(do_compile) {
 	int i = 0;
 	SV *eval = newSVpv("",0), *cmdline;
-	code = ApachePerlRun_readscript(r);
+	code = ApachePerlRun_mapscript(r);
 	SAVEFREESV(code);
 
 	if((cmdline = ApachePerlRun_parse_cmdline(r, (SV*)SvRV(code)))) {
@@ -3,22 +3,48 @@
 typedef struct {
     SV *cv;
     table *only;
+    SV *key, *val;
 } TableDo;
 
+/*
+ * reuse the mortal key/val SVs made by do() across calls,
+ * unless the callback kept a reference to one of them or
+ * left magic (pos(), taint, ...) or the utf8 flag on it
+ */
+#ifdef SvUTF8
+#define table_do_sv_dirty(sv) (SvMAGICAL(sv) || SvUTF8(sv))
+#else
+#define table_do_sv_dirty(sv) SvMAGICAL(sv)
+#endif
+
+static SV *table_do_sv(SV **svp, const char *str)
+{
+    if((SvREFCNT(*svp) == 1) && !SvREADONLY(*svp) &&
+       !table_do_sv_dirty(*svp))
+	sv_setpv(*svp, (char *)str);
+    else
+	*svp = sv_2mortal(newSVpv((char *)str,0));
+    return *svp;
+}
+
 #define table_pool(t) ((array_header *)(t))->pool
 
 static int Apache_table_do(TableDo *td, const char *key, const char *val)
 {
     int count=0, rv=1;
+    SV *ksv, *vsv;
     dSP;
 
     if(td->only && !table_get(td->only, key))
        return 1;
 
+    ksv = table_do_sv(&td->key, key);
+    vsv = table_do_sv(&td->val, val);
+
     ENTER;SAVETMPS;
     PUSHMARK(sp);
-    XPUSHs(sv_2mortal(newSVpv((char *)key,0)));
-    XPUSHs(sv_2mortal(newSVpv((char *)val,0)));
+    XPUSHs(ksv);
+    XPUSHs(vsv);
     PUTBACK;
     count = perl_call_sv(td->cv, G_SCALAR);
     SPAGAIN;
@@ -69,7 +95,7 @@ table_delete(table *tab, const char *key, const char *val)
 
 static Apache__Table ApacheTable_new(table *utable)
 {
-    Apache__Table RETVAL = (Apache__Table)safemalloc(sizeof(TiedTable));
+    Apache__Table RETVAL = (Apache__Table)mod_perl_tmp_alloc(sizeof(TiedTable));
     RETVAL->utable = utable;
     RETVAL->ix = 0;
     RETVAL->elts = NULL;
@@ -116,7 +142,7 @@ DESTROY(self)
     CODE:
     tab = (Apache__Table)hvrv2table(self);
     if(SvROK(self) && SvTYPE(SvRV(self)) == SVt_PVHV) 
-        safefree(tab);
+        mod_perl_tmp_free(tab, sizeof(TiedTable));
 
 void
 FETCH(self, key)
@@ -261,6 +287,8 @@ do(self, cv, ...)
     PREINIT:
     TableDo td;
     td.only = (table *)NULL;
+    td.key = sv_newmortal();
+    td.val = sv_newmortal();
 
     CODE:
     if(items > 2) {
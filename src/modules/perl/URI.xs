@@ -1,15 +1,371 @@
 #include "mod_perl.h"
 #include "mod_perl_xs.h"
 
+/* the components, in the order components() returns them */
+#define URI_SCHEME    0
+#define URI_HOSTINFO  1
+#define URI_USER      2
+#define URI_PASSWORD  3
+#define URI_HOSTNAME  4
+#define URI_PORT      5
+#define URI_PATH      6
+#define URI_QUERY     7
+#define URI_FRAGMENT  8
+#define URI_PATH_INFO 9
+#define URI_PARTS     10
+
+static char *uri_part_names[] = {
+    "scheme", "hostinfo", "user", "password", "hostname",
+    "port", "path", "query", "fragment", "path_info",
+};
+
 typedef struct {
     uri_components uri;
     pool *pool;
     request_rec *r;
     char *path_info;
+    SV *parts[URI_PARTS]; /* created on first access */
 } XS_Apache__URI;
 
 typedef XS_Apache__URI * Apache__URI;
 
+static Apache__URI uri_new(request_rec *r)
+{
+    Apache__URI uri =
+	(Apache__URI)mod_perl_tmp_alloc(sizeof(XS_Apache__URI));
+    Zero(uri->parts, URI_PARTS, SV *);
+    uri->pool = r->pool;
+    uri->r = r;
+    uri->path_info = NULL;
+    return uri;
+}
+
+static void uri_parts_clear(Apache__URI uri)
+{
+    int i;
+    for (i = 0; i < URI_PARTS; i++) {
+	if (uri->parts[i]) {
+	    SvREFCNT_dec(uri->parts[i]);
+	    uri->parts[i] = Nullsv;
+	}
+    }
+}
+
+static char **uri_part_ptr(Apache__URI uri, int i)
+{
+    switch (i) {
+      case URI_SCHEME:
+	return &uri->uri.scheme;
+      case URI_HOSTINFO:
+	return &uri->uri.hostinfo;
+      case URI_USER:
+	return &uri->uri.user;
+      case URI_PASSWORD:
+	return &uri->uri.password;
+      case URI_HOSTNAME:
+	return &uri->uri.hostname;
+      case URI_PORT:
+	return &uri->uri.port_str;
+      case URI_PATH:
+	return &uri->uri.path;
+      case URI_QUERY:
+	return &uri->uri.query;
+      case URI_FRAGMENT:
+	return &uri->uri.fragment;
+      default:
+	return &uri->path_info;
+    }
+}
+
+/*
+ * the cached SV still holds component i as parsed, callers get the
+ * SV itself and may have modified it in place
+ */
+static int uri_part_same(SV *sv, char *thing)
+{
+    STRLEN len;
+
+    if (SvMAGICAL(sv) || SvREADONLY(sv)) {
+	return 0;
+    }
+    if (!thing) {
+	return !SvOK(sv);
+    }
+    len = strlen(thing);
+#ifdef SvUTF8
+    if (SvUTF8(sv)) {
+	return 0;
+    }
+#endif
+    return SvPOK(sv) && SvCUR(sv) == len && memEQ(SvPVX(sv), thing, len);
+}
+
+/*
+ * a mortal reference to the SV for component i, kept on the object so
+ * repeated calls hand out the same one without allocating.  if the
+ * last caller still holds it or changed it, a fresh one replaces it.
+ * with val, the component is set and the old value returned
+ */
+static SV *uri_part(Apache__URI uri, int i, SV *val)
+{
+    char **thing = uri_part_ptr(uri, i);
+    SV *sv = uri->parts[i];
+
+    if (sv && (SvREFCNT(sv) > 1 || !uri_part_same(sv, *thing))) {
+	SvREFCNT_dec(sv);
+	sv = Nullsv;
+    }
+    if (!sv) {
+	sv = uri->parts[i] = *thing ? newSVpv(*thing, 0) : newSV(0);
+    }
+    if (val) {
+	*thing = SvOK(val) ? pstrdup(uri->pool, SvPV(val, na)) : NULL;
+	if (i == URI_PORT) {
+	    uri->uri.port = (int)SvIV(val);
+	}
+	uri->parts[i] = Nullsv;
+	return sv_2mortal(sv);
+    }
+    return sv_2mortal(SvREFCNT_inc(sv));
+}
+
+/* canonical() steps */
+#define URI_STEP_SLASHES 1
+#define URI_STEP_DOTS    2
+#define URI_STEP_ESCAPES 4
+#define URI_STEP_HOST    8
+#define URI_STEP_PORT    16
+#define URI_STEP_QUERY   32
+
+#define URI_STEPS_PATH (URI_STEP_SLASHES|URI_STEP_DOTS|URI_STEP_ESCAPES)
+#define URI_STEPS_DEFAULT (URI_STEPS_PATH|URI_STEP_HOST|URI_STEP_PORT)
+
+static int uri_steps(SV **args, int n, int dflt)
+{
+    int i, steps = 0;
+
+    if (!n) {
+	return dflt;
+    }
+    for (i = 0; i < n; i++) {
+	char *name = SvPV(args[i], na);
+	if (strEQ(name, "slashes"))
+	    steps |= URI_STEP_SLASHES;
+	else if (strEQ(name, "dots"))
+	    steps |= URI_STEP_DOTS;
+	else if (strEQ(name, "escapes"))
+	    steps |= URI_STEP_ESCAPES;
+	else if (strEQ(name, "host"))
+	    steps |= URI_STEP_HOST;
+	else if (strEQ(name, "port"))
+	    steps |= URI_STEP_PORT;
+	else if (strEQ(name, "query"))
+	    steps |= URI_STEP_QUERY;
+	else
+	    croak("unknown Apache::URI normalization step `%s'", name);
+    }
+    return steps;
+}
+
+#define uri_unreserved(c) \
+    (ap_isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~')
+
+#define uri_hexval(c) \
+    (ap_isdigit(c) ? (c) - '0' : ap_toupper(c) - 'A' + 10)
+
+/* decode escaped unreserved characters, uppercase the hex of the rest */
+static STRLEN uri_normalize_escapes(char *p, STRLEN len)
+{
+    char *s = p, *d = p, *end = p + len;
+
+    while (s < end) {
+	if (*s == '%' && s + 2 < end &&
+	    ap_isxdigit(s[1]) && ap_isxdigit(s[2])) {
+	    int c = (uri_hexval(s[1]) << 4) | uri_hexval(s[2]);
+	    if (uri_unreserved(c)) {
+		*d++ = c;
+	    }
+	    else {
+		d[0] = '%';
+		d[1] = ap_toupper(s[1]);
+		d[2] = ap_toupper(s[2]);
+		d += 3;
+	    }
+	    s += 3;
+	}
+	else {
+	    *d++ = *s++;
+	}
+    }
+    return d - p;
+}
+
+/*
+ * collapse repeated slashes and remove "." and ".." segments
+ * (RFC 2396 section 5.2), the result is never longer so this
+ * works in place
+ */
+static STRLEN uri_normalize_segments(char *p, STRLEN len, int steps)
+{
+    char *s = p, *d = p, *end = p + len;
+
+    while (s < end) {
+	if (*s != '/') {
+	    *d++ = *s++;
+	    continue;
+	}
+	if (steps & URI_STEP_SLASHES) {
+	    while (s + 1 < end && s[1] == '/') {
+		s++;
+	    }
+	}
+	if ((steps & URI_STEP_DOTS) && s + 1 < end && s[1] == '.') {
+	    if (s + 2 == end || s[2] == '/') {
+		s += 2;
+		if (s == end) {
+		    *d++ = '/';
+		}
+		continue;
+	    }
+	    if (s[2] == '.' && (s + 3 == end || s[3] == '/')) {
+		/* drop the last segment written */
+		while (d > p && *--d != '/')
+		    ;
+		s += 3;
+		if (s == end) {
+		    *d++ = '/';
+		}
+		continue;
+	    }
+	}
+	*d++ = *s++;
+    }
+    return d - p;
+}
+
+static STRLEN uri_normalize_path(char *p, STRLEN len, int steps)
+{
+    if (steps & URI_STEP_ESCAPES) {
+	len = uri_normalize_escapes(p, len);
+    }
+    if (steps & (URI_STEP_SLASHES|URI_STEP_DOTS)) {
+	len = uri_normalize_segments(p, len, steps);
+    }
+    p[len] = '\0';
+    return len;
+}
+
+typedef struct {
+    char *arg;
+    int klen;
+    int pos;
+} uri_qarg;
+
+static int uri_qarg_cmp(const void *a, const void *b)
+{
+    const uri_qarg *x = (const uri_qarg *)a, *y = (const uri_qarg *)b;
+    int n = memcmp(x->arg, y->arg, x->klen < y->klen ? x->klen : y->klen);
+
+    if (!n) {
+	n = x->klen - y->klen;
+    }
+    return n ? n : x->pos - y->pos;
+}
+
+/* sort the arguments by name, keeping the order of repeated names */
+static char *uri_sort_query(pool *p, char *query)
+{
+    int n = 1, i = 0;
+    uri_qarg *args;
+    char *s, *d, *copy;
+
+    for (s = query; *s; s++) {
+	if (*s == '&')
+	    n++;
+    }
+    if (n == 1) {
+	return query;
+    }
+
+    copy = pstrdup(p, query);
+    args = (uri_qarg *)palloc(p, n * sizeof(uri_qarg));
+    for (s = copy; s; ) {
+	char *amp = strchr(s, '&');
+	if (amp) {
+	    *amp = '\0';
+	}
+	if (*s) {
+	    char *eq = strchr(s, '=');
+	    args[i].arg = s;
+	    args[i].klen = eq ? eq - s : strlen(s);
+	    args[i].pos = i;
+	    i++;
+	}
+	s = amp ? amp + 1 : NULL;
+    }
+    qsort(args, i, sizeof(uri_qarg), uri_qarg_cmp);
+
+    for (d = query, n = 0; n < i; n++) {
+	int len = strlen(args[n].arg);
+	if (n) {
+	    *d++ = '&';
+	}
+	Copy(args[n].arg, d, len, char);
+	d += len;
+    }
+    *d = '\0';
+    return query;
+}
+
+static void uri_canonical(Apache__URI uri, int steps)
+{
+    uri_components *u = &uri->uri;
+
+    /*
+     * work on copies, the strings of $r->parsed_uri are shared with
+     * the request, r->uri and r->args point into them
+     */
+    if ((steps & URI_STEP_HOST) && u->scheme) {
+	u->scheme = pstrdup(uri->pool, u->scheme);
+	ap_str_tolower(u->scheme);
+    }
+    if ((steps & URI_STEP_HOST) && u->hostname) {
+	u->hostname = pstrdup(uri->pool, u->hostname);
+	ap_str_tolower(u->hostname);
+    }
+    if ((steps & URI_STEP_PORT) && u->port_str && u->scheme &&
+	u->port == ap_default_port_for_scheme(u->scheme)) {
+	u->port_str = NULL;
+    }
+    if ((steps & (URI_STEP_HOST|URI_STEP_PORT)) &&
+	u->hostinfo && u->hostname) {
+	u->hostinfo = ap_pstrcat(uri->pool,
+				 u->user ? u->user : "",
+				 u->password ? ":" : "",
+				 u->password ? u->password : "",
+				 u->user ? "@" : "",
+				 u->hostname,
+				 u->port_str ? ":" : "",
+				 u->port_str ? u->port_str : "",
+				 NULL);
+    }
+    if ((steps & URI_STEPS_PATH) && u->path) {
+	u->path = pstrdup(uri->pool, u->path);
+	(void)uri_normalize_path(u->path, strlen(u->path), steps);
+    }
+    if ((steps & (URI_STEP_ESCAPES|URI_STEP_QUERY)) && u->query) {
+	u->query = pstrdup(uri->pool, u->query);
+    }
+    if ((steps & URI_STEP_ESCAPES) && u->query) {
+	u->query[uri_normalize_escapes(u->query, strlen(u->query))] = '\0';
+    }
+    if ((steps & URI_STEP_QUERY) && u->query) {
+	uri_sort_query(uri->pool, u->query);
+    }
+
+    uri_parts_clear(uri);
+}
+
 MODULE = Apache::URI		PACKAGE = Apache
 
 PROTOTYPES: DISABLE
@@ -22,10 +378,8 @@ parsed_uri(r)
     Apache r
 
     CODE:
-    RETVAL = (Apache__URI)safemalloc(sizeof(XS_Apache__URI));
+    RETVAL = uri_new(r);
     RETVAL->uri = r->parsed_uri;
-    RETVAL->pool = r->pool; 
-    RETVAL->r = r;
     RETVAL->path_info = r->path_info;
 
     OUTPUT:
@@ -38,7 +392,8 @@ DESTROY(uri)
     Apache::URI uri
 
     CODE:
-    safefree(uri);
+    uri_parts_clear(uri);
+    mod_perl_tmp_free(uri, sizeof(XS_Apache__URI));
 
 Apache::URI
 parse(self, r, uri=NULL)
@@ -48,20 +403,57 @@ parse(self, r, uri=NULL)
 
     PREINIT:
     int self_uri = 0;
+    int reuse;
 
     CODE:
-    self = self; /* -Wall */ 
-    RETVAL = (Apache__URI)safemalloc(sizeof(XS_Apache__URI));
+    /* $uri->parse reparses into $uri itself */
+    reuse = SvROK(self) && sv_derived_from(self, "Apache::URI");
+    if(reuse) {
+	RETVAL = (Apache__URI)SvIV((SV*)SvRV(self));
+	uri_parts_clear(RETVAL);
+	RETVAL->pool = r->pool;
+	RETVAL->r = r;
+	RETVAL->path_info = NULL;
+    }
+    else {
+	RETVAL = uri_new(r);
+    }
     if(!uri) {
 	uri = ap_construct_url(r->pool, r->uri, r);
 	self_uri = 1;
     }
     (void)ap_parse_uri_components(r->pool, uri, &RETVAL->uri);
-    RETVAL->pool = r->pool;
-    RETVAL->r = r;
-    RETVAL->path_info = NULL;
     if(self_uri) 
 	RETVAL->uri.query = r->args;
+    if(reuse) {
+	XSRETURN(1); /* ST(0) is self */
+    }
+
+    OUTPUT:
+    RETVAL
+
+void
+canonical(uri, ...)
+    Apache::URI uri
+
+    CODE:
+    uri_canonical(uri, uri_steps(&ST(1), items - 1, URI_STEPS_DEFAULT));
+    XSRETURN(1); /* ST(0) is uri */
+
+SV *
+normalize_path(path, ...)
+    SV *path
+
+    PREINIT:
+    STRLEN len;
+    char *s;
+
+    CODE:
+    s = SvPV_force(path, len);
+    SvCUR_set(path, uri_normalize_path(s, len,
+		      uri_steps(&ST(1), items - 1, URI_STEPS_PATH)));
+    SvSETMAGIC(path);
+    RETVAL = newSVsv(path);
 
     OUTPUT:
     RETVAL
@@ -100,107 +492,35 @@ rpath(uri)
     OUTPUT:
     RETVAL 
 
-char *
-scheme(uri, ...)
-    Apache::URI uri
-
-    CODE:
-    get_set_PVp(uri->uri.scheme,uri->pool);
-
-    OUTPUT:
-    RETVAL 
-
-char *
-hostinfo(uri, ...)
-    Apache::URI uri
-
-    CODE:
-    get_set_PVp(uri->uri.hostinfo,uri->pool);
-
-    OUTPUT:
-    RETVAL 
-
-char *
-user(uri, ...)
-    Apache::URI uri
-
-    CODE:
-    get_set_PVp(uri->uri.user,uri->pool);
-
-    OUTPUT:
-    RETVAL 
-
-char *
-password(uri, ...)
-    Apache::URI uri
-
-    CODE:
-    get_set_PVp(uri->uri.password,uri->pool);
-
-    OUTPUT:
-    RETVAL 
-
-char *
-hostname(uri, ...)
-    Apache::URI uri
-
-    CODE:
-    get_set_PVp(uri->uri.hostname,uri->pool);
-
-    OUTPUT:
-    RETVAL 
-
-char *
-path(uri, ...)
-    Apache::URI uri
-
-    CODE:
-    get_set_PVp(uri->uri.path,uri->pool);
-
-    OUTPUT:
-    RETVAL 
-
-char *
-query(uri, ...)
+void
+scheme(uri, val=Nullsv)
     Apache::URI uri
+    SV *val
+
+    ALIAS:
+    hostinfo = URI_HOSTINFO
+    user = URI_USER
+    password = URI_PASSWORD
+    hostname = URI_HOSTNAME
+    port = URI_PORT
+    path = URI_PATH
+    query = URI_QUERY
+    fragment = URI_FRAGMENT
+    path_info = URI_PATH_INFO
+
+    PPCODE:
+    XPUSHs(uri_part(uri, ix, val));
 
-    CODE:
-    get_set_PVp(uri->uri.query,uri->pool);
-
-    OUTPUT:
-    RETVAL 
-
-char *
-fragment(uri, ...)
+void
+components(uri)
     Apache::URI uri
 
-    CODE:
-    get_set_PVp(uri->uri.fragment,uri->pool);
-
-    OUTPUT:
-    RETVAL 
-
-char *
-port(uri, ...)
-    Apache::URI uri
+    PREINIT:
+    int i;
 
-    CODE:
-    get_set_PVp(uri->uri.port_str,uri->pool);
-    if (items > 1) {
-        uri->uri.port = (int)SvIV(ST(1));
+    PPCODE:
+    EXTEND(sp, URI_PARTS * 2);
+    for (i = 0; i < URI_PARTS; i++) {
+	PUSHs(sv_2mortal(newSVpv(uri_part_names[i], 0)));
+	PUSHs(uri_part(uri, i, Nullsv));
     }
-
-    OUTPUT:
-    RETVAL 
-
-char *
-path_info(uri, ...)
-    Apache::URI uri
-
-    CODE:
-    get_set_PVp(uri->path_info,uri->pool);
-
-    OUTPUT:
-    RETVAL 
-
-            
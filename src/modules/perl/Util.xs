@@ -4,9 +4,100 @@
 #define TIME_NOW time(NULL)
 #define DEFAULT_TIME_FORMAT "%a, %d %b %Y %H:%M:%S %Z"
 
-#define parsedate ap_parseHTTPdate
 #define util_pool() perl_get_util_pool()
 
+/*
+ * the last string formatted for each format/gmt pair, most are
+ * formatted for the current second over and over
+ */
+#define HT_TIME_CACHE 8
+#define HT_TIME_FMTLEN 64
+#define HT_TIME_STRLEN 128
+
+typedef struct {
+    time_t t;
+    int gmt;
+    char fmt[HT_TIME_FMTLEN];
+    char str[HT_TIME_STRLEN];
+    STRLEN len;
+} ht_time_entry;
+
+static ht_time_entry ht_time_cache[HT_TIME_CACHE];
+static int ht_time_next = 0;
+
+static const char *ht_time_cached(time_t t, const char *fmt, int gmt,
+				  STRLEN *len)
+{
+    ht_time_entry *e = NULL;
+    const char *str;
+    int i;
+
+    for (i = 0; i < HT_TIME_CACHE; i++) {
+	ht_time_entry *c = &ht_time_cache[i];
+	if (c->gmt == gmt && *c->fmt && strEQ(c->fmt, fmt)) {
+	    if (c->t == t) {
+		*len = c->len;
+		return c->str;
+	    }
+	    e = c;
+	    break;
+	}
+    }
+
+    str = ap_ht_time(util_pool(), t, fmt, gmt);
+    *len = strlen(str);
+
+    if (*len >= HT_TIME_STRLEN || strlen(fmt) >= HT_TIME_FMTLEN) {
+	return str;
+    }
+    if (!e) {
+	e = &ht_time_cache[ht_time_next];
+	ht_time_next = (ht_time_next + 1) % HT_TIME_CACHE;
+	strcpy(e->fmt, fmt);
+	e->gmt = gmt;
+    }
+    e->t = t;
+    Copy(str, e->str, *len + 1, char);
+    e->len = *len;
+
+    return e->str;
+}
+
+/* the last If-Modified-Since and such dates parsed */
+#define PARSEDATE_CACHE 16
+#define PARSEDATE_LEN 64
+
+typedef struct {
+    char date[PARSEDATE_LEN];
+    time_t t;
+} parsedate_entry;
+
+static parsedate_entry parsedate_cache[PARSEDATE_CACHE];
+static int parsedate_next = 0;
+
+static time_t parsedate(const char *date)
+{
+    parsedate_entry *e;
+    int i;
+
+    for (i = 0; i < PARSEDATE_CACHE; i++) {
+	if (*parsedate_cache[i].date && strEQ(parsedate_cache[i].date, date)) {
+	    return parsedate_cache[i].t;
+	}
+    }
+
+    if (!*date || strlen(date) >= PARSEDATE_LEN) {
+	return ap_parseHTTPdate(date);
+    }
+
+    e = &parsedate_cache[parsedate_next];
+    parsedate_next = (parsedate_next + 1) % PARSEDATE_CACHE;
+    strcpy(e->date, date);
+    e->t = ap_parseHTTPdate(date);
+
+    return e->t;
+}
+
 static SV *size_string(size_t size)
 {
     SV *sv = newSVpv("    -", 5);
@@ -32,48 +123,530 @@ static SV *size_string(size_t size)
     return sv;
 }
 
-static SV *my_escape_html(char *s)
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define UTIL_SSE2
+#endif
+
+/* bytes escape_html and escape_uri must replace */
+static char html_unsafe[256];
+static char uri_unsafe[256];
+
+static void util_tables_init(void)
+{
+    int c;
+
+    html_unsafe['<'] = html_unsafe['>'] = html_unsafe['&'] = 1;
+    html_unsafe['"'] = 1;
+
+    /* the same as T_OS_ESCAPE_PATH in gen_test_char.c */
+    for (c = 0; c < 256; c++) {
+	uri_unsafe[c] = !ap_isalnum(c) && !strchr("$-_.+!*'(),:@&=/~", c);
+    }
+    uri_unsafe[0] = 1;
+}
+
+/* offset of the first byte in s[0..len) flagged in html_unsafe */
+static STRLEN html_scan(const char *s, STRLEN len)
+{
+    STRLEN i = 0;
+#ifdef UTIL_SSE2
+    const __m128i lt = _mm_set1_epi8('<'), gt = _mm_set1_epi8('>');
+    const __m128i amp = _mm_set1_epi8('&'), quot = _mm_set1_epi8('"');
+
+    for (; i + 16 <= len; i += 16) {
+	__m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+	__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, lt),
+					      _mm_cmpeq_epi8(v, gt)),
+				 _mm_or_si128(_mm_cmpeq_epi8(v, amp),
+					      _mm_cmpeq_epi8(v, quot)));
+	int bits = _mm_movemask_epi8(m);
+	if (bits) {
+	    return i + __builtin_ctz(bits);
+	}
+    }
+#endif
+    while (i < len && !html_unsafe[(unsigned char)s[i]]) {
+	i++;
+    }
+    return i;
+}
+
+static STRLEN uri_scan(const char *s, STRLEN len)
+{
+    const unsigned char *u = (const unsigned char *)s;
+    STRLEN i = 0;
+
+    for (; i + 4 <= len; i += 4) {
+	if (uri_unsafe[u[i]] | uri_unsafe[u[i+1]] |
+	    uri_unsafe[u[i+2]] | uri_unsafe[u[i+3]]) {
+	    break;
+	}
+    }
+    while (i < len && !uri_unsafe[u[i]]) {
+	i++;
+    }
+    return i;
+}
+
+static STRLEN html_extra(const char *s, STRLEN len)
+{
+    STRLEN i = 0, extra = 0;
+
+    while ((i += html_scan(s + i, len - i)) < len) {
+	switch (s[i++]) {
+	  case '<':
+	  case '>':
+	    extra += 3;
+	    break;
+	  case '&':
+	    extra += 4;
+	    break;
+	  default:
+	    extra += 5;
+	}
+    }
+    return extra;
+}
+
+static char *html_copy(char *d, const char *s, STRLEN len)
+{
+    STRLEN i = 0;
+
+    while (i < len) {
+	STRLEN run = html_scan(s + i, len - i);
+	Move(s + i, d, run, char);
+	d += run;
+	if ((i += run) == len) {
+	    break;
+	}
+	switch (s[i++]) {
+	  case '<':
+	    Copy("&lt;", d, 4, char); d += 4;
+	    break;
+	  case '>':
+	    Copy("&gt;", d, 4, char); d += 4;
+	    break;
+	  case '&':
+	    Copy("&amp;", d, 5, char); d += 5;
+	    break;
+	  default:
+	    Copy("&quot;", d, 6, char); d += 6;
+	}
+    }
+    return d;
+}
+
+static STRLEN uri_extra(const char *s, STRLEN len)
+{
+    STRLEN i = 0, extra = 0;
+
+    while ((i += uri_scan(s + i, len - i)) < len) {
+	extra += 2;
+	i++;
+    }
+    return extra;
+}
+
+static char *uri_copy(char *d, const char *s, STRLEN len)
+{
+    static const char hex[] = "0123456789abcdef";
+    STRLEN i = 0;
+
+    while (i < len) {
+	STRLEN run = uri_scan(s + i, len - i);
+	unsigned char c;
+	Move(s + i, d, run, char);
+	d += run;
+	if ((i += run) == len) {
+	    break;
+	}
+	c = (unsigned char)s[i++];
+	*d++ = '%';
+	*d++ = hex[c >> 4];
+	*d++ = hex[c & 0xf];
+    }
+    return d;
+}
+
+/* 
+ * escape sv into out, which may be sv itself, or a new SV if out is NULL
+ * clean runs are copied in bulk, in place the input is first moved to
+ * the end of the grown buffer so the output never overtakes it
+ */
+static SV *util_escape(SV *sv, SV *out,
+		       STRLEN (*extra_fn)(const char *, STRLEN),
+		       char *(*copy_fn)(char *, const char *, STRLEN))
+{
+    STRLEN len, extra;
+    char *s = SvPV(sv, len), *d;
+#ifdef SvUTF8
+    int utf8 = SvUTF8(sv); /* escaping only adds ASCII */
+#endif
+
+    extra = (*extra_fn)(s, len);
+
+    if (!out) {
+	out = newSV(len + extra + 1);
+	SvPOK_on(out);
+    }
+    else if (out == sv) {
+	if (!extra) {
+	    return out;
+	}
+	s = SvPV_force(out, len);
+	d = SvGROW(out, len + extra + 1);
+	Move(d, d + extra, len, char);
+	s = d + extra;
+    }
+    else {
+	sv_setpvn(out, "", 0);
+	SvGROW(out, len + extra + 1);
+    }
+
+    d = (*copy_fn)(SvPVX(out), s, len);
+    *d = '\0';
+    SvCUR_set(out, d - SvPVX(out));
+    (void)SvPOK_only(out);
+#ifdef SvUTF8
+    if (utf8) {
+	SvUTF8_on(out);
+    }
+#endif
+    SvSETMAGIC(out);
+    return out;
+}
+
+static const char b64_std[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char b64_url[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static const char hex_upper[] = "0123456789ABCDEF";
+static const char hex_lower[] = "0123456789abcdef";
+
+/* value of each base64 (either alphabet) and hex digit, -1 if none */
+static signed char b64_val[256];
+static signed char hex_val[256];
+
+#define CODEC_BAD ((STRLEN)-1)
+
+static void codec_tables_init(void)
+{
+    int i;
+
+    memset(b64_val, -1, sizeof(b64_val));
+    memset(hex_val, -1, sizeof(hex_val));
+    for (i = 0; i < 64; i++) {
+	b64_val[(unsigned char)b64_std[i]] = i;
+	b64_val[(unsigned char)b64_url[i]] = i;
+    }
+    for (i = 0; i < 16; i++) {
+	hex_val[(unsigned char)hex_upper[i]] = i;
+	hex_val[(unsigned char)hex_lower[i]] = i;
+    }
+}
+
+static STRLEN b64_encode(unsigned char *d, const unsigned char *s,
+			 STRLEN len, int url)
+{
+    const char *tab = url ? b64_url : b64_std;
+    unsigned char *start = d;
+    STRLEN i;
+
+    for (i = 0; i + 3 <= len; i += 3) {
+	U32 v = (s[i] << 16) | (s[i+1] << 8) | s[i+2];
+	d[0] = tab[v >> 18];
+	d[1] = tab[(v >> 12) & 0x3f];
+	d[2] = tab[(v >> 6) & 0x3f];
+	d[3] = tab[v & 0x3f];
+	d += 4;
+    }
+    if (i < len) {
+	U32 v = s[i] << 16;
+	if (i + 1 < len) {
+	    v |= s[i+1] << 8;
+	}
+	*d++ = tab[v >> 18];
+	*d++ = tab[(v >> 12) & 0x3f];
+	if (i + 1 < len) {
+	    *d++ = tab[(v >> 6) & 0x3f];
+	}
+	else if (!url) {
+	    *d++ = '=';
+	}
+	if (!url) {
+	    *d++ = '=';
+	}
+    }
+    return d - start;
+}
+
+/* whitespace is skipped, decoding stops at the first '=' */
+static STRLEN b64_decode(unsigned char *d, const unsigned char *s,
+			 STRLEN len, int flag)
 {
-    int i, j;
-    SV *x;
+    unsigned char *start = d;
+    const unsigned char *end = s + len;
+    U32 v = 0;
+    int n = 0;
+
+    while (s < end) {
+	int c;
+	/* the common case, four digits in a row */
+	if (!n && s + 4 <= end) {
+	    int a = b64_val[s[0]], b = b64_val[s[1]];
+	    int x = b64_val[s[2]], y = b64_val[s[3]];
+	    if ((a | b | x | y) >= 0) {
+		v = (a << 18) | (b << 12) | (x << 6) | y;
+		d[0] = v >> 16;
+		d[1] = (v >> 8) & 0xff;
+		d[2] = v & 0xff;
+		d += 3;
+		s += 4;
+		continue;
+	    }
+	}
+	if (*s == '=') {
+	    /* padding, only more of it or whitespace may follow */
+	    for (; s < end; s++) {
+		if (*s != '=' && !isSPACE(*s)) {
+		    return CODEC_BAD;
+		}
+	    }
+	    break;
+	}
+	if ((c = b64_val[*s++]) < 0) {
+	    if (isSPACE(s[-1])) {
+		continue;
+	    }
+	    return CODEC_BAD;
+	}
+	v = (v << 6) | c;
+	if (++n == 4) {
+	    d[0] = v >> 16;
+	    d[1] = (v >> 8) & 0xff;
+	    d[2] = v & 0xff;
+	    d += 3;
+	    n = 0;
+	    v = 0;
+	}
+    }
+
+    switch (n) {
+      case 1:
+	return CODEC_BAD;
+      case 2:
+	*d++ = v >> 4;
+	break;
+      case 3:
+	*d++ = v >> 10;
+	*d++ = (v >> 2) & 0xff;
+    }
+    flag = flag;
+    return d - start;
+}
+
+static STRLEN hex_encode(unsigned char *d, const unsigned char *s,
+			 STRLEN len, int flag)
+{
+    STRLEN i;
+
+    for (i = 0; i < len; i++) {
+	d[2*i] = hex_lower[s[i] >> 4];
+	d[2*i+1] = hex_lower[s[i] & 0xf];
+    }
+    flag = flag;
+    return 2 * len;
+}
+
+static STRLEN hex_decode(unsigned char *d, const unsigned char *s,
+			 STRLEN len, int flag)
+{
+    STRLEN i;
+
+    if (len % 2) {
+	return CODEC_BAD;
+    }
+    for (i = 0; i < len; i += 2) {
+	int hi = hex_val[s[i]], lo = hex_val[s[i+1]];
+	if ((hi | lo) < 0) {
+	    return CODEC_BAD;
+	}
+	d[i/2] = (hi << 4) | lo;
+    }
+    flag = flag;
+    return len / 2;
+}
+
+/* RFC 2045, "\n" is the line break, lines are kept to 76 characters */
+#define QP_LINE 76
+
+static STRLEN qp_encode(unsigned char *d, const unsigned char *s,
+			STRLEN len, int flag)
+{
+    unsigned char *start = d;
+    STRLEN i;
+    int col = 0;
+
+    for (i = 0; i < len; i++) {
+	unsigned char c = s[i];
+	int n, last;
 
-    /* first, count the number of extra characters */
-    for (i = 0, j = 0; s[i] != '\0'; i++)
-	if (s[i] == '<' || s[i] == '>')
-	    j += 3;
-	else if (s[i] == '&')
-	    j += 4;
-        else if (s[i] == '"')
-	    j += 5;
+	if (c == '\n') {
+	    *d++ = c;
+	    col = 0;
+	    continue;
+	}
+	/* trailing whitespace must be encoded */
+	n = ((c >= 33 && c <= 126 && c != '=') ||
+	     ((c == ' ' || c == '\t') && i + 1 < len && s[i+1] != '\n'))
+	    ? 1 : 3;
 
-    if (j == 0)
-	return newSVpv(s,i);
-    x = newSV(i + j + 1);
+	/* room for the '=' of a soft break unless the line ends here */
+	last = i + 1 == len || s[i+1] == '\n';
+	if (col + n > (last ? QP_LINE : QP_LINE - 1)) {
+	    *d++ = '=';
+	    *d++ = '\n';
+	    col = 0;
+	}
+	if (n == 1) {
+	    *d++ = c;
+	}
+	else {
+	    *d++ = '=';
+	    *d++ = hex_upper[c >> 4];
+	    *d++ = hex_upper[c & 0xf];
+	}
+	col += n;
+    }
+    flag = flag;
+    return d - start;
+}
 
-    for (i = 0, j = 0; s[i] != '\0'; i++, j++)
-	if (s[i] == '<') {
-	    memcpy(&SvPVX(x)[j], "&lt;", 4);
-	    j += 3;
+/* soft line breaks are removed, a bad '=' is kept as it is */
+static STRLEN qp_decode(unsigned char *d, const unsigned char *s,
+			STRLEN len, int flag)
+{
+    unsigned char *start = d;
+    const unsigned char *end = s + len;
+
+    while (s < end) {
+	const unsigned char *eq = memchr(s, '=', end - s), *p;
+	if (!eq) {
+	    eq = end;
 	}
-	else if (s[i] == '>') {
-	    memcpy(&SvPVX(x)[j], "&gt;", 4);
-	    j += 3;
+	Move(s, d, eq - s, char);
+	d += eq - s;
+	if ((s = eq) == end) {
+	    break;
 	}
-	else if (s[i] == '&') {
-	    memcpy(&SvPVX(x)[j], "&amp;", 5);
-	    j += 4;
+	if (s + 2 < end && hex_val[s[1]] >= 0 && hex_val[s[2]] >= 0) {
+	    *d++ = (hex_val[s[1]] << 4) | hex_val[s[2]];
+	    s += 3;
+	    continue;
 	}
-	else if (s[i] == '"') {
-	    memcpy(&SvPVX(x)[j], "&quot;", 6);
-	    j += 5;
+	for (p = s + 1; p < end && (*p == ' ' || *p == '\t' || *p == '\r'); p++)
+	    ;
+	if (p == end || *p == '\n') {
+	    s = p < end ? p + 1 : p;
+	    continue;
 	}
-	else
-	    SvPVX(x)[j] = s[i];
+	*d++ = *s++;
+    }
+    flag = flag;
+    return d - start;
+}
+
+typedef struct {
+    STRLEN (*code)(unsigned char *, const unsigned char *, STRLEN, int);
+    int flag;
+    int grows;
+} util_codec;
 
-    SvPVX(x)[j] = '\0';
-    SvCUR_set(x, j);
-    SvPOK_on(x);
-    return x;
+/* in ALIAS order */
+static util_codec util_codecs[] = {
+    { b64_encode, 0, 1 },
+    { b64_encode, 1, 1 },
+    { b64_decode, 0, 0 },
+    { hex_encode, 0, 1 },
+    { hex_decode, 0, 0 },
+    { qp_encode, 0, 1 },
+    { qp_decode, 0, 0 },
+};
+
+static STRLEN util_codec_size(int ix, STRLEN len)
+{
+    switch (ix) {
+      case 0:
+      case 1:
+	return (len + 2) / 3 * 4;
+      case 3:
+	return len * 2;
+      case 5:
+	/* every byte encoded, a soft break after at least 72 characters */
+	return len * 3 + (len / 24 + 1) * 2;
+      default:
+	return len;
+    }
+}
+
+/*
+ * run codec ix over sv, into out (which may be sv) or a new SV,
+ * the output buffer is sized for the worst case up front.
+ * decoders never write ahead of their input so they run in place,
+ * encoders build a new buffer which out then takes over.
+ * on bad input out is set to undef and NULL returned
+ */
+static SV *util_code(int ix, SV *sv, SV *out)
+{
+    util_codec *c = &util_codecs[ix];
+    STRLEN len, n;
+    unsigned char *s;
+    SV *dst;
+
+    if (out == sv) {
+	s = (unsigned char *)SvPV_force(sv, len);
+    }
+    else {
+	s = (unsigned char *)SvPV(sv, len);
+    }
+
+    if (!out) {
+	dst = newSV(util_codec_size(ix, len) + 1);
+    }
+    else if (out == sv && c->grows) {
+	dst = sv_2mortal(newSV(util_codec_size(ix, len) + 1));
+    }
+    else {
+	if (out != sv) {
+	    sv_setpvn(out, "", 0);
+	    SvGROW(out, util_codec_size(ix, len) + 1);
+	}
+	dst = out;
+    }
+
+    n = (*c->code)((unsigned char *)SvPVX(dst), s, len, c->flag);
+    if (n == CODEC_BAD) {
+	if (out) {
+	    sv_setsv(out, &sv_undef);
+	    SvSETMAGIC(out);
+	}
+	else {
+	    SvREFCNT_dec(dst);
+	}
+	return Nullsv;
+    }
+    SvCUR_set(dst, n);
+    *SvEND(dst) = '\0';
+    (void)SvPOK_only(dst);
+
+    if (out) {
+	if (dst != out) {
+	    sv_setsv(out, dst);
+	}
+	SvSETMAGIC(out);
+    }
+    return dst;
 }
 
 #define validate_password(passwd, hash) \
@@ -85,39 +658,79 @@ PROTOTYPES: DISABLE
 
 BOOT:
     items = items; /*avoid warning*/
+    util_tables_init();
+    codec_tables_init();
 
 SV *
 size_string(size)
     size_t size
 
-char *
-escape_uri(segment)
-    const char *segment
+SV *
+escape_uri(segment, out=Nullsv)
+    SV *segment
+    SV *out
+
+    ALIAS:
+    escape_html = 1
 
     CODE:
-    RETVAL = ap_os_escape_path(util_pool(), segment, TRUE);
+    if (out) {
+	util_escape(segment, out, ix ? html_extra : uri_extra,
+		    ix ? html_copy : uri_copy);
+	ST(0) = out;
+	XSRETURN(1);
+    }
+    RETVAL = util_escape(segment, Nullsv, ix ? html_extra : uri_extra,
+			 ix ? html_copy : uri_copy);
 
     OUTPUT:
     RETVAL
 
 SV *
-escape_html(s)
-    char *s
+encode_base64(sv, out=Nullsv)
+    SV *sv
+    SV *out
+
+    ALIAS:
+    encode_base64url = 1
+    decode_base64 = 2
+    encode_hex = 3
+    decode_hex = 4
+    encode_qp = 5
+    decode_qp = 6
 
     CODE:
-    RETVAL = my_escape_html(s);
+    if (!(RETVAL = util_code(ix, sv, out))) {
+	XSRETURN_UNDEF;
+    }
+    if (out) {
+	ST(0) = out;
+	XSRETURN(1);
+    }
 
     OUTPUT:
     RETVAL
 
-char *
-ht_time(t=TIME_NOW, fmt=DEFAULT_TIME_FORMAT, gmt=TRUE)
+SV *
+ht_time(t=TIME_NOW, fmt=DEFAULT_TIME_FORMAT, gmt=TRUE, out=Nullsv)
     time_t t
     const char *fmt
     int gmt
+    SV *out
+
+    PREINIT:
+    STRLEN len;
+    const char *str;
 
     CODE:
-    RETVAL = ap_ht_time(util_pool(), t, fmt, gmt);
+    str = ht_time_cached(t, fmt, gmt, &len);
+    if (out) {
+	sv_setpvn(out, str, len);
+	SvSETMAGIC(out);
+	ST(0) = out;
+	XSRETURN(1);
+    }
+    RETVAL = newSVpv(str, len);
 
     OUTPUT:
     RETVAL
@@ -798,6 +798,10 @@ void perl_startup (server_rec *s, pool *p)
     ENTER_SAFE(s,p);
     MP_TRACE_g(mod_perl_dump_opmask());
 
+    /* must come first to see what the others load */
+    if(getenv("MOD_PERL_LOAD_PROFILE"))
+	(void)perl_require_module("Apache::LoadProfile", s);
+
     entries = (char **)cls->PerlRequire->elts;
     for(i = 0; i < cls->PerlRequire->nelts; i++) {
 	if(perl_load_startup_script(s, p, entries[i], TRUE) != OK) {
@@ -968,6 +972,7 @@ void PERL_CHILD_EXIT_HOOK(server_rec *s, pool *p)
 
     PERL_CALLBACK(hook, cls->PerlChildExitHandler);
 
+    mod_perl_access_log_flush();
     perl_shutdown(s,p);
 }
 #endif
@@ -1084,6 +1089,8 @@ int PERL_LOG_HOOK(request_rec *r)
 {
     dSTATUS;
     dPPDIR;
+    if(mod_perl_access_log_enabled())
+	mod_perl_access_log(r);
     PERL_CALLBACK("PerlLogHandler", cld->PerlLogHandler);
     return status;
 }
@@ -1193,6 +1200,9 @@ void mod_perl_end_cleanup(void *data)
     PerlIO_flush(PerlIO_stdout());
 #endif
 
+    mod_perl_tmp_trim();
+    mod_perl_maintenance(r);
+
     MP_TRACE_g(fprintf(stderr, "ok\n"));
     (void)release_mutex(mod_perl_mutex); 
 }
@@ -1493,6 +1503,8 @@ int perl_call_handler(SV *sv, request_rec *r, AV *args)
     char *method = "handler";
     int defined_sub = 0, anon = 0;
     char *dispatcher = NULL;
+    mod_perl_stats_mark mark;
+    int hstats = mod_perl_handler_stats_begin(&mark, sv, r->pool);
 
     if(r->per_dir_config)
 	cld = (perl_dir_config *) get_module_config(r->per_dir_config, &perl_module);
@@ -1710,6 +1722,9 @@ callback:
     MP_TRACE_g(fprintf(stderr, "perl_call_handler: SVs = %5d, OBJs = %5d\n", 
 	    (int)sv_count, (int)sv_objcount));
 
+    if(hstats)
+	mod_perl_handler_stats_end(&mark, PERL_GET_CUR_HOOK, status);
+
     {
 	dTHRCTX;
 	if(SvMAGICAL(ERRSV))
@@ -313,6 +313,10 @@ if (av != Nullav) { \
 #define newRV_noinc(sv)	((Sv = newRV(sv)), --SvREFCNT(SvRV(Sv)), Sv)
 #endif
 
+#ifndef newSVpvn
+#define newSVpvn(s,len) ((len) ? newSVpv(s,len) : newSVpv("",0))
+#endif
+
 #ifndef SvTAINTED_on
 #define SvTAINTED_on(sv) if (tainting) sv_magic(sv, Nullsv, 't', Nullch, 0)
 #endif
@@ -1101,6 +1105,46 @@ typedef struct {
     char *info;
 } mod_perl_cmd_info;
 
+typedef struct {
+    char *name;
+    int mem;      /* memory counters taken */
+    long svs;
+    long objs;
+    long heap;
+    int timed;    /* latency start taken */
+    long usecs;
+} mod_perl_stats_mark;
+
+/* bucket i counts calls taking [2^i, 2^(i+1)) microseconds */
+#define MP_LATENCY_BUCKETS 24
+
+typedef struct {
+    unsigned long calls;
+    unsigned long errors;
+    unsigned long usecs;
+    unsigned long min_usecs;
+    unsigned long max_usecs;
+    unsigned long hist[MP_LATENCY_BUCKETS];
+} mod_perl_latency;
+
+typedef struct {
+    long calls;
+    long svs;
+    long objs;
+    long heap;
+    long max_svs;
+} mod_perl_handler_stats;
+
+/* sizes in KB */
+typedef struct {
+    long size;
+    long resident;
+    long shared;
+    long unshared; /* private resident pages */
+    long swap;
+    time_t when;
+} mod_perl_proc_size;
+
 extern module MODULE_VAR_EXPORT perl_module;
 
 /* a couple for -Wall sanity sake */
@@ -1174,6 +1218,37 @@ table *hvrv2table(SV *rv);
 void mod_perl_untaint(SV *sv);
 SV *mod_perl_gensym (char *pack);
 SV *mod_perl_slurp_filename(request_rec *r);
+SV *mod_perl_slurp_filename_ro(request_rec *r);
+SV *mod_perl_script_namespace(char *name, STRLEN len);
+I32 mod_perl_flush_namespace(HV *stash);
+int mod_perl_get_proc_size(mod_perl_proc_size *ps, int max_age);
+SV *mod_perl_cow_report(void);
+void mod_perl_mem_counters(long *svs, long *heap);
+int mod_perl_handler_stats_enable(int on, int slots);
+int mod_perl_handler_slots(void);
+int mod_perl_handler_stats_begin(mod_perl_stats_mark *m, SV *sv, pool *p);
+void mod_perl_handler_stats_end(mod_perl_stats_mark *m, const char *hook,
+				int status);
+SV *mod_perl_handler_stats_report(void);
+void mod_perl_handler_stats_clear(void);
+int mod_perl_handler_latency_enable(int on, int slots);
+SV *mod_perl_handler_latency_report(void);
+void mod_perl_handler_latency_clear(void);
+int mod_perl_maintenance_interval(int every);
+void mod_perl_defer_cleanup(SV *cv);
+void mod_perl_maintenance(request_rec *r);
+SV *mod_perl_maintenance_stats(void);
+int mod_perl_tmp_arena(int on);
+void *mod_perl_tmp_alloc(size_t size);
+void mod_perl_tmp_free(void *ptr, size_t size);
+void mod_perl_tmp_trim(void);
+SV *mod_perl_tmp_stats(void);
+void mod_perl_access_log(request_rec *r);
+void mod_perl_access_log_flush(void);
+char *mod_perl_access_log_open(char *file, int binary, char **names, int n);
+void mod_perl_access_log_close(void);
+int mod_perl_access_log_enabled(void);
+SV *mod_perl_access_log_stats(void);
 SV *mod_perl_tie_table(table *t);
 SV *perl_hvrv_magic_obj(SV *rv);
 void perl_tie_hash(HV *hv, char *pclass, SV *sv);
@@ -1181,6 +1256,7 @@ void perl_util_cleanup(void);
 void mod_perl_clear_rgy_endav(request_rec *r, SV *sv);
 void perl_stash_rgy_endav(char *s, SV *rgystash);
 void perl_run_rgy_endav(char *s);
+void mod_perl_run_rgy_endav(request_rec *r, SV *sv);
 void perl_run_endav(char *s);
 void perl_call_halt(int status);
 void perl_reload_inc(server_rec *s, pool *p);
@@ -1235,6 +1311,7 @@ CHAR_P perl_filesection (cmd_parms *cmd, void *dummy, HV *hv);
 void perl_handle_command(cmd_parms *cmd, void *config, char *line);
 void perl_handle_command_hv(HV *hv, char *key, cmd_parms *cmd, void *config);
 void perl_handle_command_av(AV *av, I32 n, char *key, cmd_parms *cmd, void *config);
+SV *perl_section_add_vhosts(AV *list);
 
 void perl_tainting_set(server_rec *s, int arg);
 CHAR_P perl_cmd_require (cmd_parms *parms, void *dummy, char *arg);
@@ -1280,6 +1357,9 @@ CHAR_P perl_cmd_perl_FLAG(cmd_parms *cmd, mod_perl_perl_dir_config *d, int flag)
 #define perl_cmd_perl_TAKE3 perl_cmd_perl_TAKE123
 #define perl_cmd_perl_TAKE13 perl_cmd_perl_TAKE123
 void *perl_perl_merge_dir_config(pool *p, void *basev, void *addv);
+int perl_merge_cache_enable(int on);
+void perl_merge_cache_clear(void);
+SV *perl_merge_cache_stats(void);
 void *perl_perl_merge_srv_config(pool *p, void *basev, void *addv);
 
 void mod_perl_dir_env(request_rec *r, perl_dir_config *cld);
@@ -110,3 +110,18 @@
 #ifndef stack_sp 
 #define stack_sp PL_stack_sp 
 #endif 
+#ifndef sub_generation
+#define sub_generation PL_sub_generation
+#endif
+#ifndef tmps_stack
+#define tmps_stack PL_tmps_stack
+#endif
+#ifndef tmps_max
+#define tmps_max PL_tmps_max
+#endif
+#ifndef tmps_ix
+#define tmps_ix PL_tmps_ix
+#endif
+#ifndef tmps_floor
+#define tmps_floor PL_tmps_floor
+#endif
@@ -55,6 +55,12 @@ extern API_VAR_EXPORT module *top_module;
 #ifdef PERL_SECTIONS
 static int perl_sections_self_boot = 0;
 static const char *perl_sections_boot_module = NULL;
+/* the <Perl> section being evaluated, for add_vhosts */
+static cmd_parms *perl_section_parms = NULL;
+/* directive errors are collected here rather than logged when set */
+static AV *perl_section_errors = Nullav;
+/* set by add_vhosts, whose hosts the section cache cannot replay */
+static int perl_section_nocache = 0;
 
 #if MODULE_MAGIC_NUMBER < 19970719
 #define limit_section limit
@@ -941,9 +947,91 @@ static SV *perl_perl_create_srv_config(SV **sv, HV *pclass, cmd_parms *parms)
     return perl_perl_create_cfg(sv, pclass, parms, PERL_SERVER_CREATE);
 }
 
+/*
+ * with Apache::ModuleConfig->merge_cache(1), the result of DIR_MERGE
+ * for each (base, add) pair of objects is kept for the life of the
+ * child, so location heavy configs only call the Perl method once per
+ * distinct merge rather than on every request.  the entries hold a
+ * reference to the objects they are keyed by, so the addresses cannot
+ * be reused.  .htaccess configs are new objects each request, the
+ * cache is emptied when it grows past PERL_MERGE_CACHE_MAX entries
+ */
+#ifndef PERL_MERGE_CACHE_MAX
+#define PERL_MERGE_CACHE_MAX 1024
+#endif
+
+static HV *merge_cache = Nullhv;
+static int merge_cache_on = 0;
+static long merge_calls = 0, merge_hits = 0;
+
+int perl_merge_cache_enable(int on)
+{
+    int old = merge_cache_on;
+    if(on >= 0) {
+	merge_cache_on = on;
+	if(!on)
+	    perl_merge_cache_clear();
+    }
+    return old;
+}
+
+void perl_merge_cache_clear(void)
+{
+    if(merge_cache) {
+	hv_undef(merge_cache);
+	SvREFCNT_dec((SV*)merge_cache);
+	merge_cache = Nullhv;
+    }
+}
+
+SV *perl_merge_cache_stats(void)
+{
+    HV *hv = newHV();
+
+    hv_store(hv, "merges",  6, newSViv(merge_calls), FALSE);
+    hv_store(hv, "hits",    4, newSViv(merge_hits), FALSE);
+    hv_store(hv, "entries", 7, 
+	     newSViv(merge_cache ? HvKEYS(merge_cache) : 0), FALSE);
+    hv_store(hv, "enabled", 7, newSViv(merge_cache_on), FALSE);
+
+    return newRV_noinc((SV*)hv);
+}
+
+static SV *merge_cache_fetch(SV *key[2])
+{
+    SV **svp;
+
+    if(!merge_cache)
+	return Nullsv;
+    if(!(svp = hv_fetch(merge_cache, (char *)key, sizeof(SV*)*2, FALSE)))
+	return Nullsv;
+
+    merge_hits++;
+    return *av_fetch((AV*)SvRV(*svp), 0, FALSE);
+}
+
+static void merge_cache_store(SV *key[2], SV *sv)
+{
+    AV *av;
+
+    if(!merge_cache)
+	merge_cache = newHV();
+    else if(HvKEYS(merge_cache) >= PERL_MERGE_CACHE_MAX)
+	hv_clear(merge_cache);
+
+    av = newAV();
+    av_push(av, SvREFCNT_inc(sv));
+    av_push(av, SvREFCNT_inc(key[0]));
+    av_push(av, SvREFCNT_inc(key[1]));
+    hv_store(merge_cache, (char *)key, sizeof(SV*)*2, 
+	     newRV_noinc((SV*)av), FALSE);
+}
+
 static void *perl_perl_merge_cfg(pool *p, void *basev, void *addv, char *meth)
 {
     GV *gv;
+    SV *key[2];
+    int use_cache = 0;
     mod_perl_perl_dir_config *mrg = NULL,
 	*basevp = (mod_perl_perl_dir_config *)basev,
 	*addvp  = (mod_perl_perl_dir_config *)addv;
@@ -959,12 +1047,27 @@ static void *perl_perl_merge_cfg(pool *p, void *basev, void *addv, char *meth)
     MP_TRACE_c(fprintf(stderr, "looking for method %s in package `%s'\n", 
 		       meth, SvCLASS(basesv)));
 
+    mrg = (mod_perl_perl_dir_config *)
+	palloc(p, sizeof(mod_perl_perl_dir_config));
+
+    if(merge_cache_on && addsv && strEQ(meth, PERL_DIR_MERGE)) {
+	key[0] = basesv;
+	key[1] = addsv;
+	use_cache = 1;
+	if((sv = merge_cache_fetch(key))) {
+	    mrg->obj = SvREFCNT_inc(sv);
+	    mrg->pclass = SvCLASS(sv);
+	    register_cleanup(p, (void*)mrg,
+			     perl_perl_cmd_cleanup, mod_perl_noop);
+	    return (void *)mrg;
+	}
+    }
+
     if((gv = gv_fetchmethod_autoload(SvSTASH(SvRV(basesv)), meth, FALSE)) && isGV(gv)) {
 	int count;
 	dSP;
-	mrg = (mod_perl_perl_dir_config *)
-	    palloc(p, sizeof(mod_perl_perl_dir_config));
 
+	merge_calls++;
 	MP_TRACE_c(fprintf(stderr, "calling %s->%s\n", 
 			   SvCLASS(basesv), meth));
 
@@ -978,6 +1081,8 @@ static void *perl_perl_merge_cfg(pool *p, void *basev, void *addv, char *meth)
 	    sv = POPs;
 	    ++SvREFCNT(sv);
 	    mrg->pclass = SvCLASS(sv);
+	    if(use_cache)
+		merge_cache_store(key, sv);
 	}
 	PUTBACK;
 	FREETMPS;LEAVE;
@@ -1194,8 +1299,12 @@ void perl_section_hash_walk(cmd_parms *cmd, void *cfg, HV *hv)
 			 line, 
 			 (errmsg ? errmsg : "OK"),
 			 (cmd->limited > 0 ? "yes" : "no") ));
-	if(errmsg)
-	    log_printf(cmd->server, "<Perl>: %s", errmsg);
+	if(errmsg) {
+	    if(perl_section_errors)
+		av_push(perl_section_errors, newSVpvf("%s: %s", line, errmsg));
+	    else
+		log_printf(cmd->server, "<Perl>: %s", errmsg);
+	}
     }
 
     cmd->info = old_info;
@@ -1223,25 +1332,15 @@ void perl_section_hash_walk(cmd_parms *cmd, void *cfg, HV *hv)
  * had a handful of callback hooks instead
  */
 
-CHAR_P perl_virtualhost_section (cmd_parms *cmd, void *dummy, HV *hv)
+static const char *perl_virtualhost_add(cmd_parms *cmd, char *arg, HV *tab)
 {
-    dSEC;
     server_rec *main_server = cmd->server, *s;
-    pool *p = cmd->pool;
-    char *arg; 
     const char *errmsg = NULL;
-    dSECiter_start
-
-    if(entries) {
-	SECiter_list(perl_virtualhost_section(cmd, dummy, tab));
-    }
-
-    arg = pstrdup(cmd->pool, getword_conf (cmd->pool, &key));
 
 #if MODULE_MAGIC_NUMBER >= 19970912
-    errmsg = init_virtual_host(p, arg, main_server, &s);
+    errmsg = init_virtual_host(cmd->pool, arg, main_server, &s);
 #else
-    s = init_virtual_host(p, arg, main_server);
+    s = init_virtual_host(cmd->pool, arg, main_server);
 #endif
 
     if (errmsg)
@@ -1261,12 +1360,94 @@ CHAR_P perl_virtualhost_section (cmd_parms *cmd, void *dummy, HV *hv)
     perl_section_hash_walk(cmd, s->lookup_defaults, tab);
 
     cmd->server = main_server;
+    return NULL;
+}
+
+CHAR_P perl_virtualhost_section (cmd_parms *cmd, void *dummy, HV *hv)
+{
+    dSEC;
+    char *arg; 
+    const char *errmsg = NULL;
+    dSECiter_start
+
+    if(entries) {
+	SECiter_list(perl_virtualhost_section(cmd, dummy, tab));
+    }
+
+    arg = pstrdup(cmd->pool, getword_conf (cmd->pool, &key));
+
+    if ((errmsg = perl_virtualhost_add(cmd, arg, tab)))
+	return errmsg;   
 
     dSECiter_stop
     TRACE_SECTION_END("VirtualHost");
     return NULL;
 }
 
+/*
+ * Apache::PerlSections->add_vhosts([$address => \%config], ...)
+ * creates the virtual hosts straight from the list, without going
+ * through %VirtualHost.  returns a hash ref of the list positions
+ * whose host could not be configured, each with an array ref of
+ * error messages
+ */
+SV *perl_section_add_vhosts(AV *list)
+{
+    dTHR;
+    cmd_parms *cmd = perl_section_parms;
+    HV *errors;
+    I32 i;
+
+    if(!cmd)
+	croak("add_vhosts called outside of a <Perl> section");
+
+    /* the hosts are not in %Apache::ReadConfig, so not in a cache dump */
+    perl_section_nocache = 1;
+
+    /* mortal, in case of a croak part way through the list */
+    errors = (HV*)sv_2mortal((SV*)newHV());
+
+    for(i=0; i<=AvFILL(list); i++) {
+	SV **svp = av_fetch(list, i, FALSE);
+	AV *ent, *errav;
+	SV **addr, **conf;
+	const char *errmsg;
+	char *arg;
+	STRLEN n_a;
+
+	if(!svp || !SvROK(*svp) || (SvTYPE(SvRV(*svp)) != SVt_PVAV))
+	    croak("add_vhosts: element %d is not an ARRAY reference", (int)i);
+	ent = (AV*)SvRV(*svp);
+	addr = av_fetch(ent, 0, FALSE);
+	conf = av_fetch(ent, 1, FALSE);
+
+	errav = (AV*)sv_2mortal((SV*)newAV());
+	if(!addr || !conf || !SvROK(*conf) ||
+	   (SvTYPE(SvRV(*conf)) != SVt_PVHV)) {
+	    av_push(errav, newSVpv("expected [$address => \\%config]",0));
+	}
+	else {
+	    arg = pstrdup(cmd->pool, SvPV(*addr,n_a));
+	    /* restored by LEAVE, or by the unwind if a directive dies */
+	    ENTER;
+	    SAVESPTR(perl_section_errors);
+	    perl_section_errors = errav;
+	    errmsg = perl_virtualhost_add(cmd, arg, (HV*)SvRV(*conf));
+	    LEAVE;
+	    if(errmsg)
+		av_push(errav, newSVpv((char *)errmsg,0));
+	}
+
+	if(AvFILL(errav) >= 0) {
+	    char key[16];
+	    int klen = sprintf(key, "%d", (int)i);
+	    hv_store(errors, key, klen, newRV_inc((SV*)errav), FALSE);
+	}
+    }
+
+    return newRV_inc((SV*)errors);
+}
+
 #if MODULE_MAGIC_NUMBER > 19970719 /* 1.3a1 */
 #include "fnmatch.h"
 #ifdef WIN32
@@ -1499,7 +1680,10 @@ void perl_handle_command(cmd_parms *cmd, void *config, char *line)
 
     MP_TRACE_s(fprintf(stderr, "handle_command (%s): ", line));
     if ((errmsg = handle_command(cmd, config, line))) {
-	if ((sv = STRICT_PERL_SECTIONS_SV) && SvTRUE(sv)) {
+	if (perl_section_errors) {
+	    av_push(perl_section_errors, newSVpvf("%s: %s", line, errmsg));
+	}
+	else if ((sv = STRICT_PERL_SECTIONS_SV) && SvTRUE(sv)) {
 	    croak("<Perl>: %s", errmsg);
 	}
 	else {
@@ -1726,13 +1910,48 @@ void perl_clear_symtab(HV *symtab)
     }
 }
 
+#define PERL_SECTION_CACHE_SV \
+perl_get_sv("Apache::Server::PerlSectionCache", FALSE)
+
+/*
+ * Apache::PerlSections->cache_fetch($code) returns the dump of
+ * %Apache::ReadConfig saved the last time $code was run, if none
+ * of the files it depends on have changed since.
+ * Apache::PerlSections->cache_store($code) saves one.
+ */
+static SV *perl_section_cache(cmd_parms *parms, char *meth, SV *code)
+{
+    dTHR;
+    SV *sv = Nullsv;
+    int count;
+    dSP;
+
+    ENTER;SAVETMPS;
+    PUSHMARK(sp);
+    XPUSHs(sv_2mortal(newSVpv("Apache::PerlSections",0)));
+    XPUSHs(code);
+    PUTBACK;
+    count = perl_call_method(meth, G_EVAL | G_SCALAR);
+    SPAGAIN;
+    if((count == 1) && (perl_eval_ok(parms->server) == OK)) {
+	sv = POPs;
+	sv = SvTRUE(sv) ? newSVsv(sv) : Nullsv;
+    }
+    PUTBACK;
+    FREETMPS;LEAVE;
+
+    MP_TRACE_s(fprintf(stderr, "perl_section: %s %s\n", 
+		       meth, sv ? "hit" : "miss"));
+    return sv;
+}
+
 CHAR_P perl_section (cmd_parms *parms, void *dummy, const char *arg)
 {
     CHAR_P errmsg;
-    SV *code, *val;
+    SV *code, *val, *cached = Nullsv;
     HV *symtab;
     char *key;
-    I32 klen, dotie=FALSE;
+    I32 klen, dotie=FALSE, use_cache=FALSE;
     char line[MAX_STRING_LEN];
     /* Use the parser context */
     void *config = USABLE_CONTEXT;
@@ -1766,14 +1985,29 @@ CHAR_P perl_section (cmd_parms *parms, void *dummy, const char *arg)
 
     sv_setpv(perl_get_sv("0", TRUE), cmd_filename);
 
+    if(arg && (val = PERL_SECTION_CACHE_SV) && SvTRUE(val) &&
+       (perl_require_module("Apache::PerlSections", parms->server) == OK))
+    {
+	use_cache = TRUE;
+	cached = perl_section_cache(parms, "cache_fetch", code);
+    }
+
     ENTER_SAFE(parms->server, parms->pool);
     MP_TRACE_g(mod_perl_dump_opmask());
 
     {
         SV *server_sv = perl_get_sv("Apache::__SERVER", FALSE);
         IV ptr = SvIVX(SvRV(server_sv));
+        cmd_parms *old_parms = perl_section_parms;
+        int old_nocache = perl_section_nocache;
         SvIVX(SvRV(server_sv)) = (IV)parms->server;
-        perl_eval_sv(code, G_DISCARD);
+        perl_section_parms = parms;
+        perl_section_nocache = 0;
+        perl_eval_sv(cached ? cached : code, G_DISCARD);
+        if(perl_section_nocache)
+            use_cache = FALSE;
+        perl_section_nocache = old_nocache;
+        perl_section_parms = old_parms;
         SvIVX(SvRV(server_sv)) = (IV)ptr;
     }
 
@@ -1782,6 +2016,8 @@ CHAR_P perl_section (cmd_parms *parms, void *dummy, const char *arg)
     {
 	dTHR;
 	dTHRCTX;
+	if(cached)
+	    SvREFCNT_dec(cached);
 	if(SvTRUE(ERRSV)) {
 	    MP_TRACE_s(fprintf(stderr, 
 			       "Apache::ReadConfig: %s\n", SvPV(ERRSV,na)));
@@ -1789,6 +2025,10 @@ CHAR_P perl_section (cmd_parms *parms, void *dummy, const char *arg)
 	}
     }
 
+    /* save the result before the walk below eats the arrays */
+    if(use_cache && !cached)
+	(void)perl_section_cache(parms, "cache_store", code);
+
     symtab = (HV*)gv_stashpv(PERL_SECTIONS_PACKAGE, FALSE);
     (void)hv_iterinit(symtab);
     while ((val = hv_iternextsv(symtab, &key, &klen))) {
@@ -49,183 +49,1643 @@
 
 #include "mod_perl.h"
 
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
 static HV *mod_perl_endhv = Nullhv;
+static HV *mod_perl_nshv = Nullhv;
+static HV *mod_perl_hstats = Nullhv;
+static AV *maint_deferred = Nullav;
+static int mod_perl_hstats_on = 0;
+static HV *latency_hv = Nullhv;
+static int latency_on = 0;
 static int set_ids = 0;
 
+static void cow_cleanup(void);
+static void tmp_release(int keep);
+
 void perl_util_cleanup(void)
 {
     hv_undef(mod_perl_endhv);
     SvREFCNT_dec((SV*)mod_perl_endhv);
     mod_perl_endhv = Nullhv;
 
-    set_ids = 0;
+    if(mod_perl_nshv) {
+	hv_undef(mod_perl_nshv);
+	SvREFCNT_dec((SV*)mod_perl_nshv);
+	mod_perl_nshv = Nullhv;
+    }
+
+    if(maint_deferred) {
+	SvREFCNT_dec((SV*)maint_deferred);
+	maint_deferred = Nullav;
+    }
+
+    if(mod_perl_hstats) {
+	hv_undef(mod_perl_hstats);
+	SvREFCNT_dec((SV*)mod_perl_hstats);
+	mod_perl_hstats = Nullhv;
+    }
+
+    if(latency_hv) {
+	hv_undef(latency_hv);
+	SvREFCNT_dec((SV*)latency_hv);
+	latency_hv = Nullhv;
+    }
+
+    cow_cleanup();
+    tmp_release(0);
+#ifdef PERL_DIRECTIVE_HANDLERS
+    perl_merge_cache_clear();
+#endif
+    set_ids = 0;
+}
+
+SV *array_header2avrv(array_header *arr)
+{
+    AV *av;
+    int i;
+    dTHR;
+
+    iniAV(av);
+    if(arr) {
+	for (i = 0; i < arr->nelts; i++) {
+	    av_push(av, newSVpv(((char **) arr->elts)[i], 0));
+	}
+    }
+    return newRV_noinc((SV*)av);
+}
+
+array_header *avrv2array_header(SV *avrv, pool *p)
+{
+    AV *av = (AV*)SvRV(avrv);
+    I32 i;
+    array_header *arr = make_array(p, AvFILL(av)-1, sizeof(char *));
+
+    for(i=0; i<=AvFILL(av); i++) {
+	SV *sv = *av_fetch(av, i, FALSE);    
+	char **entry = (char **) push_array(arr);
+	*entry = pstrdup(p, SvPV(sv,na));
+    }
+
+    return arr;
+}
+
+table *hvrv2table(SV *rv)
+{
+    if(SvROK(rv) && SvTYPE(SvRV(rv)) == SVt_PVHV) {
+	SV *sv = perl_hvrv_magic_obj(rv);
+	if(!sv) croak("HV is not magic!");
+	return (table *)SvIV((SV*)SvRV(sv));
+    }
+    return (table *)SvIV((SV*)SvRV(rv));
+}
+
+static char *r_keys[] = { "_r", "r", NULL };
+
+static request_rec *r_magic_get(SV *sv)
+{
+    MAGIC *mg  = mg_find(sv, '~');
+    return mg ? (request_rec *)mg->mg_ptr : NULL;
+}
+
+request_rec *sv2request_rec(SV *in, char *pclass, CV *cv)
+{
+    request_rec *r = NULL;
+    SV *sv = Nullsv;
+
+    if(in == &sv_undef) return NULL;
+
+    if(SvROK(in) && (SvTYPE(SvRV(in)) == SVt_PVHV)) {
+	int i;
+	for (i=0; r_keys[i]; i++) {
+	    int klen = strlen(r_keys[i]);
+	    if(hv_exists((HV*)SvRV(in), r_keys[i], klen) &&
+	       (sv = *hv_fetch((HV*)SvRV(in), 
+			       r_keys[i], klen, FALSE))) {
+                if (SvROK(sv) && (SvTYPE(SvRV(sv)) == SVt_PVHV)) {
+                    /* dig deeper */
+                    return sv2request_rec(sv, pclass, cv);
+                }
+		break;
+            }
+	}
+	if(!sv)
+	    croak("method `%s' invoked by a `%s' object with no `r' key!",
+		  GvNAME(CvGV(cv)), HvNAME(SvSTASH(SvRV(in))));
+    }
+
+    if(!sv) sv = in;
+    if(SvROK(sv) && (SvTYPE(SvRV(sv)) == SVt_PVMG)) {
+	if(sv_derived_from(sv, pclass)) {
+	    if((r = r_magic_get(SvRV(sv)))) {
+		/* ~ magic */
+	    }
+	    else {
+		r = (request_rec *) SvIV((SV*)SvRV(sv));
+	    }
+	}
+	else {
+	    return NULL;
+	}
+    }
+    else if((r = perl_request_rec(NULL))) {
+	/*ok*/
+    } 
+    else {
+	croak("Apache->%s called without setting Apache->request!",
+	      GvNAME(CvGV(cv)));
+    }
+    return r;
+}
+
+pool *perl_get_util_pool(void)
+{
+    request_rec *r = NULL;
+
+    if((r = perl_request_rec(NULL)))
+        return r->pool;
+    else
+        return perl_get_startup_pool();
+    return NULL;
+}
+
+pool *perl_get_startup_pool(void)
+{
+    SV *sv = perl_get_sv("Apache::__POOL", FALSE);
+    if(sv) {
+	IV tmp = SvIV((SV*)SvRV(sv));
+	return (pool *)tmp;
+    }
+    return NULL;
+}
+
+server_rec *perl_get_startup_server(void)
+{
+    SV *sv = perl_get_sv("Apache::__SERVER", FALSE);
+    if(sv) {
+	IV tmp = SvIV((SV*)SvRV(sv));
+	return (server_rec *)tmp;
+    }
+    return NULL;
+}
+
+void mod_perl_untaint(SV *sv)
+{
+    if(!tainting) return;
+    if (SvTYPE(sv) >= SVt_PVMG && SvMAGIC(sv)) {
+	MAGIC *mg = mg_find(sv, 't');
+	if (mg)
+	    mg->mg_len &= ~1;
+    }
+}
+
+/* same as Symbol::gensym() */
+SV *mod_perl_gensym (char *pack)
+{
+    GV *gv = newGVgen(pack);
+    SV *rv = newRV((SV*)gv);
+    (void)hv_delete(gv_stashpv(pack, TRUE), 
+		    GvNAME(gv), GvNAMELEN(gv), G_DISCARD);
+    return rv;
+}
+
+#ifdef USE_MMAP_FILES
+#include <sys/mman.h>
+
+#ifndef PERL_MMAP_THRESHOLD
+#define PERL_MMAP_THRESHOLD (16*1024)
+#endif
+
+/* the mapping is owned by the SV, released when the SV is freed */
+static int mmap_slurp_free(pTHX_ SV *sv, MAGIC *mg)
+{
+    MP_TRACE_g(fprintf(stderr, "munmap %d bytes\n", (int)SvCUR(sv)));
+    munmap(SvPVX(sv), SvCUR(sv));
+    SvPVX(sv) = Nullch;
+    SvCUR_set(sv, 0);
+    SvPOK_off(sv);
+    return 0;
+}
+
+static MGVTBL mmap_slurp_vtbl = {0, 0, 0, 0, mmap_slurp_free};
+
+/*
+ * map the file and hand back a read-only SV pointing into the mapping,
+ * rather than copying it to the heap.  only used for regular files
+ * whose size is not a multiple of the page size, so the \0 after the
+ * last byte, which perl expects, is the zero fill of the last page.
+ * returns Nullsv if the file cannot or should not be mapped
+ */
+static SV *mmap_slurp_filename(request_rec *r)
+{
+    struct stat st;
+    MAGIC *mg;
+    caddr_t mm;
+    SV *sv;
+    int fd;
+
+    if((fd = open(r->filename, O_RDONLY)) < 0)
+	return Nullsv;
+
+    if((fstat(fd, &st) < 0) || !S_ISREG(st.st_mode) ||
+       (st.st_size < PERL_MMAP_THRESHOLD) ||
+       (st.st_size % getpagesize() == 0))
+    {
+	close(fd);
+	return Nullsv;
+    }
+
+    mm = (caddr_t)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mm == (caddr_t)-1)
+	return Nullsv;
+
+    sv = newSV(0);
+    sv_upgrade(sv, SVt_PVMG);
+    SvPVX(sv) = (char *)mm;
+    SvCUR_set(sv, st.st_size);
+    SvLEN_set(sv, 0); /* not ours to free */
+    SvPOK_only(sv);
+
+    sv_magic(sv, Nullsv, '~', Nullch, 0);
+    mg = mg_find(sv, '~');
+    mg->mg_virtual = &mmap_slurp_vtbl; /* mg_ptr would be Safefree'd */
+    SvREADONLY_on(sv);
+
+    MP_TRACE_g(fprintf(stderr, "mmap'd %d bytes of %s\n",
+		       (int)st.st_size, r->filename));
+    return sv;
+}
+#endif
+
+SV *mod_perl_slurp_filename(request_rec *r)
+{
+    dTHR;
+    PerlIO *fp;
+    SV *insv;
+
+    ENTER;
+    save_item(rs);
+    sv_setsv(rs, &sv_undef); 
+
+    fp = PerlIO_open(r->filename, "r");
+    insv = newSV(r->finfo.st_size);
+    sv_gets(insv, fp, 0); /*slurp*/
+    PerlIO_close(fp);
+    LEAVE;
+    return newRV_noinc(insv);
+}
+
+/*
+ * for code which is compiled and then thrown away, the SV may be a
+ * read-only mapping of the file, which must be released before the
+ * file can be modified again
+ */
+SV *mod_perl_slurp_filename_ro(request_rec *r)
+{
+#ifdef USE_MMAP_FILES
+    SV *insv;
+
+    if((insv = mmap_slurp_filename(r)))
+	return newRV_noinc(insv);
+#endif
+    return mod_perl_slurp_filename(r);
+}
+
+static const char c2x_table[] = "0123456789abcdef";
+
+static char *c2x(unsigned what, char *where)
+{
+    *where++ = '_';
+    *where++ = c2x_table[(what >> 4) & 0xf];
+    *where++ = c2x_table[what & 0xf];
+    return where;
+}
+
+/*
+ * same as Apache::Registry's two passes, in one:
+ *  s/([^A-Za-z0-9_\/])/sprintf("_%02x",unpack("C",$1))/eg;
+ *  s{(/+)(\d?)}["::" . (length $2 ? sprintf("_%02x",unpack("C",$2)) : "")]egx;
+ */
+static SV *script2stash(const char *s, STRLEN len)
+{
+    SV *sv = newSV(3 * len + 1);
+    const char *end = s + len;
+    char *d = SvPVX(sv);
+
+    while(s < end) {
+	unsigned char c = (unsigned char)*s++;
+	if(c == '/') {
+	    while(s < end && *s == '/')
+		s++;
+	    *d++ = ':';
+	    *d++ = ':';
+	    if(s < end && isDIGIT(*s))
+		d = c2x((unsigned char)*s++, d);
+	}
+	else if((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+		(c >= '0' && c <= '9') || c == '_')
+	    *d++ = c;
+	else
+	    d = c2x(c, d);
+    }
+    *d = '\0';
+    SvCUR_set(sv, d - SvPVX(sv));
+    SvPOK_on(sv);
+    return sv;
+}
+
+/* script name => package name, computed once per-child, 
+ * shared by Apache::Registry, Apache::PerlRun and Apache::PerlRunXS
+ * the SV returned belongs to the cache, copy it before the next call.
+ * names come from request uris, so the cache is emptied when it grows
+ * past PERL_NAMESPACE_CACHE_MAX entries
+ */
+#ifndef PERL_NAMESPACE_CACHE_MAX
+#define PERL_NAMESPACE_CACHE_MAX 1024
+#endif
+
+SV *mod_perl_script_namespace(char *name, STRLEN len)
+{
+    SV **svp, *sv;
+
+    if(mod_perl_nshv == Nullhv)
+	mod_perl_nshv = newHV();
+    else if((svp = hv_fetch(mod_perl_nshv, name, len, FALSE)))
+	return *svp;
+    else if(HvKEYS(mod_perl_nshv) >= PERL_NAMESPACE_CACHE_MAX)
+	hv_clear(mod_perl_nshv);
+
+    sv = script2stash(name, len);
+    hv_store(mod_perl_nshv, name, len, sv, FALSE);
+    MP_TRACE_g(fprintf(stderr, "caching namespace `%s' for `%s'\n",
+		       SvPVX(sv), name));
+    return sv;
+}
+
+/*
+ * reset the globs of an Apache::PerlRun script package, the same as
+ * Apache::PerlRun::flush_namespace, but only globs which actually hold
+ * something are touched.  every slot gets a fresh (empty) thingy so
+ * imported variables and subs are left alone in their home package.
+ * returns the number of globs reset, or -1 if the package contains
+ * something other than globs, the caller should then fall back to the
+ * full walk in Perl.
+ */
+I32 mod_perl_flush_namespace(HV *stash)
+{
+    SV *val;
+    char *key;
+    I32 klen, n = 0;
+    int subs = 0;
+    dTHR;
+
+    (void)hv_iterinit(stash);
+    while ((val = hv_iternextsv(stash, &key, &klen))) {
+	GV *gv = (GV*)val;
+	SV *sv;
+	HV *hv;
+	AV *av;
+	CV *cv;
+	IO *io;
+	int dirty = 0;
+
+	if(SvTYPE(val) != SVt_PVGV) {
+	    MP_TRACE_g(fprintf(stderr,
+		  "flush_namespace: `%s' is not a glob, falling back\n", key));
+	    return -1;
+	}
+	/* nested packages belong to other scripts */
+	if((klen > 2) && (key[klen-1] == ':') && (key[klen-2] == ':'))
+	    continue;
+
+	if((hv = GvHV(gv)) && (HvKEYS(hv) || SvRMAGICAL(hv))) {
+	    GvHV(gv) = newHV();
+	    SvREFCNT_dec((SV*)hv);
+	    ++dirty;
+	}
+	if((av = GvAV(gv)) && (AvFILL(av) >= 0 || SvRMAGICAL(av))) {
+	    GvAV(gv) = newAV();
+	    SvREFCNT_dec((SV*)av);
+	    ++dirty;
+	}
+	if((sv = GvSV(gv)) && SvTRUE(sv)) {
+	    GvSV(gv) = newSV(0);
+	    SvREFCNT_dec(sv);
+	    ++dirty;
+	}
+	if((cv = GvCV(gv))) {
+	    GvCV_set(gv, Nullcv);
+	    GvCVGEN(gv) = 0;
+	    SvREFCNT_dec((SV*)cv);
+	    ++subs;
+	    ++dirty;
+	}
+	if((io = GvIOp(gv)) && IoIFP(io)) {
+	    do_close(gv, FALSE);
+	    ++dirty;
+	}
+
+	if(dirty) ++n;
+    }
+
+    /* invalidate method caches once for the whole package */
+    if(subs) {
+#ifdef mro_method_changed_in
+	mro_method_changed_in(stash);
+#else
+	sub_generation++;
+#endif
+    }
+
+    MP_TRACE_g(fprintf(stderr, "flush_namespace: reset %d globs in %s\n",
+		       (int)n, HvNAME(stash)));
+    return n;
+}
+
+#ifdef __linux__
+/*
+ * the /proc/self files are opened once per process and re-read with
+ * pread() into the same buffer.  an fd inherited across fork() still
+ * points at the parent, so reopen when the pid changes.
+ * smaps_rollup (linux 4.14+) gives accurate shared and swap numbers
+ * without walking every mapping, statm is the fallback
+ */
+static pid_t proc_pid = 0;
+static int statm_fd = -1, rollup_fd = -1;
+static char proc_buf[HUGE_STRING_LEN];
+
+static int proc_read(int fd)
+{
+    int n = pread(fd, proc_buf, sizeof(proc_buf)-1, 0);
+    if(n < 0) return 0;
+    proc_buf[n] = '\0';
+    return n;
+}
+
+static long rollup_field(char *name)
+{
+    char *s = strstr(proc_buf, name);
+    return s ? atol(s + strlen(name)) : 0;
+}
+
+static int proc_size_read(mod_perl_proc_size *ps)
+{
+    long pagekb = getpagesize() / 1024;
+    long size = 0, resident = 0, shared = 0;
+
+    if(proc_pid != getpid()) {
+	if(statm_fd >= 0)  close(statm_fd);
+	if(rollup_fd >= 0) close(rollup_fd);
+	statm_fd  = open("/proc/self/statm", O_RDONLY);
+	rollup_fd = open("/proc/self/smaps_rollup", O_RDONLY);
+	proc_pid = getpid();
+    }
+
+    if((statm_fd < 0) || !proc_read(statm_fd))
+	return -1;
+    if(sscanf(proc_buf, "%ld %ld %ld", &size, &resident, &shared) != 3)
+	return -1;
+
+    ps->size = size * pagekb;
+    ps->resident = resident * pagekb;
+
+    if((rollup_fd >= 0) && proc_read(rollup_fd)) {
+	ps->shared = rollup_field("\nShared_Clean:") +
+	    rollup_field("\nShared_Dirty:");
+	ps->unshared = rollup_field("\nPrivate_Clean:") +
+	    rollup_field("\nPrivate_Dirty:");
+	ps->swap = rollup_field("\nSwap:");
+    }
+    else {
+	ps->shared = shared * pagekb;
+	ps->unshared = (resident - shared) * pagekb;
+	ps->swap = 0;
+    }
+
+    return 0;
+}
+#endif
+
+/*
+ * process size numbers for Apache::SizeLimit and Apache::Status,
+ * the last reading is reused if it is less than max_age seconds old.
+ * returns -1 if they cannot be had on this platform
+ */
+int mod_perl_get_proc_size(mod_perl_proc_size *ps, int max_age)
+{
+#ifdef __linux__
+    static mod_perl_proc_size last = {0, 0, 0, 0, 0, 0};
+    time_t now = time(NULL);
+
+    if(!(last.when && (now - last.when) < max_age && proc_pid == getpid())) {
+	if(proc_size_read(&last) < 0)
+	    return -1;
+	last.when = now;
+	MP_TRACE_g(fprintf(stderr, "proc size: %ld KB, shared %ld KB\n",
+			   last.size, last.shared));
+    }
+
+    *ps = last;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/*
+ * per-handler counters, so a leaking handler can be found without a
+ * -DPERL_TRACE build.  off unless switched on with
+ * Apache->handler_stats_enable, keyed by "phase handler".  given a
+ * number of slots at startup they live in the shared handler slots
+ * below, otherwise per-child, a mod_perl_handler_stats packed in the PV
+ */
+/* PL_sv_objcount went away in perl 5.20, objects are not counted there */
+#if PATCHLEVEL < 20
+#define MP_SV_OBJCOUNT sv_objcount
+#endif
+
+static long heap_in_use(void)
+{
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2,33)
+    struct mallinfo2 mi = mallinfo2();
+    return (long)mi.uordblks;
+#else
+    struct mallinfo mi = mallinfo();
+    return (long)mi.uordblks;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void mod_perl_mem_counters(long *svs, long *heap)
+{
+    *svs = (long)sv_count;
+    *heap = heap_in_use();
+}
+
+/*
+ * shared handler slots: an anonymous shared mapping made in the parent
+ * by the first of Apache->handler_stats_enable and
+ * Apache->handler_latency_enable given a number of slots, one slot per
+ * handler of each phase, which every child updates with atomic adds
+ */
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+#if !defined(MAP_ANON) && defined(MAP_ANONYMOUS)
+#define MAP_ANON MAP_ANONYMOUS
+#endif
+
+/* without atomics the counters stay per-child, never shared */
+#if defined(__GNUC__) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 1)))
+#define MP_SHM_ATOMIC
+#define shm_add(p, n) (void)__sync_fetch_and_add((p), (n))
+#define shm_cas(p, o, n) __sync_bool_compare_and_swap((p), (o), (n))
+#define shm_sync() __sync_synchronize()
+#else
+#define shm_add(p, n) (*(p) += (n))
+#define shm_cas(p, o, n) ((*(p) == (o)) ? ((*(p) = (n)), 1) : 0)
+#define shm_sync()
+#endif
+
+#define MP_HANDLER_KEYLEN 128
+
+typedef struct {
+    unsigned long hash;  /* 0 while free, claimed with shm_cas */
+    int ready;           /* key has been written */
+    char key[MP_HANDLER_KEYLEN];
+    mod_perl_handler_stats hs;
+    mod_perl_latency lat;
+} mp_handler_slot;
+
+typedef struct {
+    time_t since;        /* of the latency counters */
+    int slots;
+    unsigned long dropped;
+    mp_handler_slot slot[1];
+} mp_handler_table;
+
+static mp_handler_table *handler_shm = NULL;
+
+static void handler_shm_map(int slots)
+{
+#if defined(MAP_ANON) && defined(MP_SHM_ATOMIC)
+    size_t size;
+    void *mm;
+
+    if(slots <= 0 || handler_shm)
+	return;
+
+    size = sizeof(mp_handler_table) + (slots - 1) * sizeof(mp_handler_slot);
+    mm = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANON, -1, 0);
+    if(mm == (void *)MAP_FAILED) {
+	MP_TRACE_g(fprintf(stderr, "handler slots mmap failed: %s\n",
+			   strerror(errno)));
+	return;
+    }
+    handler_shm = (mp_handler_table *)mm; /* mmap zero fills */
+    handler_shm->slots = slots;
+    handler_shm->since = time(NULL);
+#endif
+}
+
+static unsigned long handler_hash(const char *key)
+{
+    unsigned long h = 5381;
+    while(*key)
+	h = h * 33 + (unsigned char)*key++;
+    return h ? h : 1;
+}
+
+static mp_handler_slot *handler_shm_slot(const char *key)
+{
+    mp_handler_table *t = handler_shm;
+    unsigned long h = handler_hash(key);
+    int i, n;
+
+    for(n = 0, i = h % t->slots; n < t->slots; n++, i = (i + 1) % t->slots) {
+	mp_handler_slot *s = &t->slot[i];
+	int spin = 100000;
+
+	if(s->hash == 0 && shm_cas(&s->hash, 0, h)) {
+	    strncpy(s->key, key, MP_HANDLER_KEYLEN - 1);
+	    shm_sync();
+	    s->ready = 1;
+	    return s;
+	}
+	if(s->hash != h)
+	    continue;
+	/* another child is writing the key, a strncpy away */
+	while(!*(volatile int *)&s->ready && --spin)
+	    ;
+	if(!spin)
+	    break; /* the writer died, drop rather than claim a second slot */
+	shm_sync();
+	if(strnEQ(s->key, key, MP_HANDLER_KEYLEN - 1))
+	    return s;
+    }
+
+    shm_add(&t->dropped, 1);
+    return NULL;
+}
+
+/*
+ * per-handler latency, switched on with Apache->handler_latency_enable,
+ * in the shared handler slots when there are some, otherwise in a
+ * per-child hash like the memory counters above
+ */
+static time_t latency_since = 0;
+
+static long latency_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    if(clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+	return (long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long)tv.tv_sec * 1000000 + tv.tv_usec;
+    }
+}
+
+static void latency_add(mod_perl_latency *lat, unsigned long usecs,
+			int status)
+{
+    unsigned long old;
+    int b = 0;
+
+    while(b < MP_LATENCY_BUCKETS - 1 && (usecs >> (b + 1)))
+	b++;
+
+    shm_add(&lat->calls, 1);
+    if(status >= SERVER_ERROR)
+	shm_add(&lat->errors, 1);
+    shm_add(&lat->usecs, usecs);
+    shm_add(&lat->hist[b], 1);
+
+    /* 0 means no call yet */
+    while(((old = lat->min_usecs) == 0 || usecs < old) &&
+	  !shm_cas(&lat->min_usecs, old, usecs ? usecs : 1))
+	;
+    while(usecs > (old = lat->max_usecs) &&
+	  !shm_cas(&lat->max_usecs, old, usecs))
+	;
+}
+
+static void latency_record(mp_handler_slot *slot, SV *key,
+			   long usecs, int status)
+{
+    mod_perl_latency *lat;
+
+    if(usecs < 0)
+	usecs = 0;
+
+    if(handler_shm) {
+	lat = slot ? &slot->lat : NULL;
+    }
+    else {
+	SV **svp;
+	if(!latency_hv)
+	    latency_hv = newHV();
+	svp = hv_fetch(latency_hv, SvPVX(key), SvCUR(key), TRUE);
+	if(!SvPOK(*svp)) {
+	    mod_perl_latency zero;
+	    Zero(&zero, 1, mod_perl_latency);
+	    sv_setpvn(*svp, (char *)&zero, sizeof(zero));
+	}
+	lat = (mod_perl_latency *)SvPVX(*svp);
+    }
+
+    if(lat)
+	latency_add(lat, (unsigned long)usecs, status);
+}
+
+int mod_perl_handler_latency_enable(int on, int slots)
+{
+    int old = latency_on;
+
+    if(on >= 0)
+	latency_on = on;
+    if(!latency_since)
+	latency_since = time(NULL);
+    if(on > 0)
+	handler_shm_map(slots);
+
+    return old;
+}
+
+static SV *latency_row(const char *key, mod_perl_latency *lat)
+{
+    AV *row = newAV(), *hist = newAV();
+    char *sp = strchr(key, ' ');
+    int i;
+
+    for(i = 0; i < MP_LATENCY_BUCKETS; i++)
+	av_push(hist, newSVnv((double)lat->hist[i]));
+
+    av_push(row, sp ? newSVpv(key, sp - key) : newSVpv("unknown", 0));
+    av_push(row, newSVpv(sp ? sp + 1 : key, 0));
+    av_push(row, newSVnv((double)lat->calls));
+    av_push(row, newSVnv((double)lat->errors));
+    av_push(row, newSVnv((double)lat->usecs));
+    av_push(row, newSVnv((double)lat->min_usecs));
+    av_push(row, newSVnv((double)lat->max_usecs));
+    av_push(row, newRV_noinc((SV*)hist));
+    return newRV_noinc((SV*)row);
+}
+
+/*
+ * {since, shared (slots, 0 if per-child), dropped, handlers}, where
+ * handlers are [phase, handler, calls, errors, usecs, min, max, [hist]]
+ */
+SV *mod_perl_handler_latency_report(void)
+{
+    HV *hv = newHV();
+    AV *av = newAV();
+    int i;
+
+    if(handler_shm) {
+	mp_handler_table *t = handler_shm;
+	for(i = 0; i < t->slots; i++) {
+	    mp_handler_slot *s = &t->slot[i];
+	    if(s->ready && s->lat.calls)
+		av_push(av, latency_row(s->key, &s->lat));
+	}
+	hv_store(hv, "since", 5, newSViv((IV)t->since), 0);
+	hv_store(hv, "shared", 6, newSViv(t->slots), 0);
+	hv_store(hv, "dropped", 7, newSVnv((double)t->dropped), 0);
+    }
+    else {
+	if(latency_hv) {
+	    SV *val;
+	    char *key;
+	    I32 klen;
+	    (void)hv_iterinit(latency_hv);
+	    while((val = hv_iternextsv(latency_hv, &key, &klen)))
+		av_push(av, latency_row(key, (mod_perl_latency *)SvPVX(val)));
+	}
+	hv_store(hv, "since", 5, newSViv((IV)latency_since), 0);
+	hv_store(hv, "shared", 6, newSViv(0), 0);
+	hv_store(hv, "dropped", 7, newSViv(0), 0);
+    }
+    hv_store(hv, "handlers", 8, newRV_noinc((SV*)av), 0);
+
+    return newRV_noinc((SV*)hv);
+}
+
+/* names stay in their shared slots, only the counters are zeroed */
+void mod_perl_handler_latency_clear(void)
+{
+    int i;
+
+    if(handler_shm) {
+	for(i = 0; i < handler_shm->slots; i++)
+	    Zero(&handler_shm->slot[i].lat, 1, mod_perl_latency);
+	handler_shm->dropped = 0;
+	handler_shm->since = time(NULL);
+    }
+    if(latency_hv)
+	hv_clear(latency_hv);
+    latency_since = time(NULL);
+}
+
+int mod_perl_handler_stats_enable(int on, int slots)
+{
+    int old = mod_perl_hstats_on;
+    if(on >= 0) mod_perl_hstats_on = on;
+    if(on > 0)
+	handler_shm_map(slots);
+    return old;
+}
+
+/* number of shared handler slots, 0 when the counters are per-child */
+int mod_perl_handler_slots(void)
+{
+    return handler_shm ? handler_shm->slots : 0;
+}
+
+int mod_perl_handler_stats_begin(mod_perl_stats_mark *m, SV *sv, pool *p)
+{
+    dTHR;
+
+    if(!(mod_perl_hstats_on || latency_on))
+	return FALSE;
+
+    if(SvROK(sv) && (SvTYPE(SvRV(sv)) == SVt_PVCV)) {
+	SV *name = newSV(0);
+	gv_fullname(name, CvGV((CV*)SvRV(sv)));
+	m->name = pstrdup(p, SvPVX(name));
+	SvREFCNT_dec(name);
+    }
+    else if(SvPOK(sv) && strnNE(SvPVX(sv), "sub ", 4))
+	m->name = pstrdup(p, SvPVX(sv));
+    else
+	m->name = "__ANON__";
+
+    if((m->mem = mod_perl_hstats_on)) {
+	m->svs  = sv_count;
+#ifdef MP_SV_OBJCOUNT
+	m->objs = MP_SV_OBJCOUNT;
+#endif
+	m->heap = heap_in_use();
+    }
+    if((m->timed = latency_on))
+	m->usecs = latency_now();
+    return TRUE;
+}
+
+void mod_perl_handler_stats_end(mod_perl_stats_mark *m, const char *hook,
+				int status)
+{
+    dTHR;
+    mod_perl_handler_stats *hs;
+    mp_handler_slot *slot = NULL;
+    SV *key;
+    long svs, max;
+
+    key = newSVpvf("%s %s", hook ? hook : "unknown", m->name);
+    if(handler_shm)
+	slot = handler_shm_slot(SvPVX(key));
+
+    if(m->timed)
+	latency_record(slot, key, latency_now() - m->usecs, status);
+
+    if(!m->mem) {
+	SvREFCNT_dec(key);
+	return;
+    }
+
+    if(handler_shm) {
+	hs = slot ? &slot->hs : NULL;
+    }
+    else {
+	SV **svp;
+	if(!mod_perl_hstats)
+	    mod_perl_hstats = newHV();
+	svp = hv_fetch(mod_perl_hstats, SvPVX(key), SvCUR(key), TRUE);
+	if(!SvPOK(*svp)) {
+	    mod_perl_handler_stats zero;
+	    Zero(&zero, 1, mod_perl_handler_stats);
+	    sv_setpvn(*svp, (char *)&zero, sizeof(zero));
+	}
+	hs = (mod_perl_handler_stats *)SvPVX(*svp);
+    }
+    SvREFCNT_dec(key);
+    if(!hs)
+	return;
+
+    svs = sv_count - m->svs;
+    shm_add(&hs->calls, 1);
+    shm_add(&hs->svs, svs);
+#ifdef MP_SV_OBJCOUNT
+    shm_add(&hs->objs, MP_SV_OBJCOUNT - m->objs);
+#endif
+    shm_add(&hs->heap, heap_in_use() - m->heap);
+    while(svs > (max = hs->max_svs) && !shm_cas(&hs->max_svs, max, svs))
+	;
+}
+
+static SV *hstats_row(const char *key, mod_perl_handler_stats *hs)
+{
+    char *sp = strchr(key, ' ');
+    AV *row = newAV();
+
+    av_push(row, newSVpv(key, sp - key));
+    av_push(row, newSVpv(sp + 1, 0));
+    av_push(row, newSViv(hs->calls));
+    av_push(row, newSViv(hs->svs));
+#ifdef MP_SV_OBJCOUNT
+    av_push(row, newSViv(hs->objs));
+#else
+    av_push(row, newSVsv(&sv_undef));
+#endif
+    av_push(row, newSViv(hs->heap));
+    av_push(row, newSViv(hs->max_svs));
+    return newRV_noinc((SV*)row);
+}
+
+/*
+ * [phase, handler, calls, svs, objs, heap, max svs] for each handler,
+ * the deltas are totals over all calls
+ */
+SV *mod_perl_handler_stats_report(void)
+{
+    AV *av = newAV();
+    SV *val;
+    char *key;
+    I32 klen;
+    int i;
+
+    if(handler_shm) {
+	for(i = 0; i < handler_shm->slots; i++) {
+	    mp_handler_slot *s = &handler_shm->slot[i];
+	    if(s->ready && s->hs.calls)
+		av_push(av, hstats_row(s->key, &s->hs));
+	}
+	return newRV_noinc((SV*)av);
+    }
+
+    if(!mod_perl_hstats)
+	return newRV_noinc((SV*)av);
+
+    (void)hv_iterinit(mod_perl_hstats);
+    while((val = hv_iternextsv(mod_perl_hstats, &key, &klen)))
+	av_push(av, hstats_row(key, (mod_perl_handler_stats *)SvPVX(val)));
+
+    return newRV_noinc((SV*)av);
+}
+
+void mod_perl_handler_stats_clear(void)
+{
+    int i;
+
+    if(handler_shm) {
+	for(i = 0; i < handler_shm->slots; i++)
+	    Zero(&handler_shm->slot[i].hs, 1, mod_perl_handler_stats);
+    }
+    if(mod_perl_hstats)
+	hv_clear(mod_perl_hstats);
+}
+
+/*
+ * post-request maintenance, run from mod_perl_end_cleanup once the
+ * response has been flushed to the client.  every maint_every
+ * requests: run the deferred cleanups, shrink the temps stack back
+ * down and hand free heap back to the system, so the child does not
+ * keep (and get killed by Apache::SizeLimit for) memory it is not
+ * using.  deferred cleanups run at the end of each request when the
+ * maintenance stage is off
+ */
+#ifndef PERL_TMPS_KEEP
+#define PERL_TMPS_KEEP 512
+#endif
+
+static int maint_every = 0, maint_count = 0;
+static struct {
+    long runs;
+    long usecs;
+    long bytes;
+    long deferred;
+} maint_stats = {0, 0, 0, 0};
+
+int mod_perl_maintenance_interval(int every)
+{
+    int old = maint_every;
+    if(every >= 0) {
+	maint_every = every;
+	maint_count = 0;
+    }
+    return old;
+}
+
+void mod_perl_defer_cleanup(SV *cv)
+{
+    if(!maint_deferred)
+	maint_deferred = newAV();
+    av_push(maint_deferred, newSVsv(cv));
+}
+
+static void run_deferred(request_rec *r)
+{
+    dTHR;
+    AV *av = maint_deferred;
+    I32 i;
+
+    if(!av || AvFILL(av) < 0)
+	return;
+
+    maint_deferred = Nullav; /* they may defer more */
+    for(i=0; i<=AvFILL(av); i++) {
+	SV *cv = *av_fetch(av, i, FALSE);
+	dSP;
+	PUSHMARK(sp);
+	perl_call_sv(cv, G_DISCARD | G_EVAL | G_NOARGS);
+	if(SvTRUE(ERRSV))
+	    mod_perl_error(r->server, SvPV(ERRSV,na));
+	maint_stats.deferred++;
+    }
+    SvREFCNT_dec((SV*)av);
+}
+
+void mod_perl_maintenance(request_rec *r)
+{
+    dTHR;
+#ifdef HAS_GETTIMEOFDAY
+    struct timeval start, end;
+#endif
+#ifdef __linux__
+    mod_perl_proc_size before, after;
+#endif
+
+    if(!maint_every || (++maint_count < maint_every)) {
+	run_deferred(r);
+	return;
+    }
+    maint_count = 0;
+
+    /* the client should not wait for us */
+    if(!r->connection->aborted)
+	bflush(r->connection->client);
+
+#ifdef HAS_GETTIMEOFDAY
+    gettimeofday(&start, NULL);
+#endif
+#ifdef __linux__
+    if(mod_perl_get_proc_size(&before, 0) < 0)
+	before.resident = 0;
+#endif
+
+    run_deferred(r);
+
+    if((tmps_ix < 0) && (tmps_floor < 0) && (tmps_max > PERL_TMPS_KEEP)) {
+	Renew(tmps_stack, PERL_TMPS_KEEP, SV*);
+	tmps_max = PERL_TMPS_KEEP;
+    }
+
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+
+#ifdef __linux__
+    if(before.resident && (mod_perl_get_proc_size(&after, 0) == 0) &&
+       (after.resident < before.resident))
+	maint_stats.bytes += (before.resident - after.resident) * 1024;
+#endif
+
+    maint_stats.runs++;
+#ifdef HAS_GETTIMEOFDAY
+    gettimeofday(&end, NULL);
+    maint_stats.usecs += (end.tv_sec - start.tv_sec) * 1000000 +
+	(end.tv_usec - start.tv_usec);
+#endif
+
+    MP_TRACE_g(fprintf(stderr, "maintenance run %ld: %ld bytes returned\n",
+		       maint_stats.runs, maint_stats.bytes));
+}
+
+SV *mod_perl_maintenance_stats(void)
+{
+    HV *hv = newHV();
+
+    hv_store(hv, "runs",     4, newSViv(maint_stats.runs), FALSE);
+    hv_store(hv, "usecs",    5, newSViv(maint_stats.usecs), FALSE);
+    hv_store(hv, "bytes",    5, newSViv(maint_stats.bytes), FALSE);
+    hv_store(hv, "deferred", 8, newSViv(maint_stats.deferred), FALSE);
+    hv_store(hv, "interval", 8, newSViv(maint_every), FALSE);
+
+    return newRV_noinc((SV*)hv);
+}
+
+/*
+ * recycling for the small structs the XS glue mallocs and frees on
+ * nearly every request (the TiedTable behind each tied table, the
+ * Apache::URI object, Apache::File's parse results).  when turned on,
+ * freed structs are kept on a free list per size and handed out again
+ * instead of going back to malloc.  mod_perl_end_cleanup gives anything
+ * past PERL_TMP_KEEP per list back in bulk.  the SVs themselves must
+ * still come from perl's own arenas
+ */
+#ifndef PERL_TMP_KEEP
+#define PERL_TMP_KEEP 32
+#endif
+#define PERL_TMP_LISTS 4
+
+typedef struct mp_tmp_item {
+    struct mp_tmp_item *next;
+} mp_tmp_item;
+
+static int tmp_arena_on = 0;
+static struct {
+    size_t size;
+    int cached;
+    mp_tmp_item *head;
+} tmp_lists[PERL_TMP_LISTS];
+static struct {
+    long hits;
+    long misses;
+    long released;
+} tmp_stats = {0, 0, 0};
+
+static int tmp_list(size_t size)
+{
+    int i;
+    for(i=0; i<PERL_TMP_LISTS; i++) {
+	if(tmp_lists[i].size == size)
+	    return i;
+	if(!tmp_lists[i].size) {
+	    tmp_lists[i].size = size;
+	    return i;
+	}
+    }
+    return -1;
+}
+
+static void tmp_release(int keep)
+{
+    int i;
+    for(i=0; i<PERL_TMP_LISTS; i++) {
+	while(tmp_lists[i].cached > keep) {
+	    mp_tmp_item *item = tmp_lists[i].head;
+	    tmp_lists[i].head = item->next;
+	    tmp_lists[i].cached--;
+	    safefree(item);
+	    tmp_stats.released++;
+	}
+    }
+}
+
+int mod_perl_tmp_arena(int on)
+{
+    int old = tmp_arena_on;
+    if(on >= 0) {
+	tmp_arena_on = on;
+	if(!on)
+	    tmp_release(0);
+    }
+    return old;
 }
 
-SV *array_header2avrv(array_header *arr)
+void *mod_perl_tmp_alloc(size_t size)
 {
-    AV *av;
     int i;
-    dTHR;
 
-    iniAV(av);
-    if(arr) {
-	for (i = 0; i < arr->nelts; i++) {
-	    av_push(av, newSVpv(((char **) arr->elts)[i], 0));
-	}
+    if(size < sizeof(mp_tmp_item))
+	size = sizeof(mp_tmp_item);
+
+    if(tmp_arena_on && ((i = tmp_list(size)) >= 0) && tmp_lists[i].head) {
+	mp_tmp_item *item = tmp_lists[i].head;
+	tmp_lists[i].head = item->next;
+	tmp_lists[i].cached--;
+	tmp_stats.hits++;
+	return (void *)item;
     }
-    return newRV_noinc((SV*)av);
+
+    if(tmp_arena_on)
+	tmp_stats.misses++;
+    return (void *)safemalloc(size);
 }
 
-array_header *avrv2array_header(SV *avrv, pool *p)
+void mod_perl_tmp_free(void *ptr, size_t size)
 {
-    AV *av = (AV*)SvRV(avrv);
-    I32 i;
-    array_header *arr = make_array(p, AvFILL(av)-1, sizeof(char *));
+    int i;
 
-    for(i=0; i<=AvFILL(av); i++) {
-	SV *sv = *av_fetch(av, i, FALSE);    
-	char **entry = (char **) push_array(arr);
-	*entry = pstrdup(p, SvPV(sv,na));
+    if(size < sizeof(mp_tmp_item))
+	size = sizeof(mp_tmp_item);
+
+    if(tmp_arena_on && ((i = tmp_list(size)) >= 0)) {
+	mp_tmp_item *item = (mp_tmp_item *)ptr;
+	item->next = tmp_lists[i].head;
+	tmp_lists[i].head = item;
+	tmp_lists[i].cached++;
+	return;
     }
 
-    return arr;
+    safefree(ptr);
 }
 
-table *hvrv2table(SV *rv)
+void mod_perl_tmp_trim(void)
 {
-    if(SvROK(rv) && SvTYPE(SvRV(rv)) == SVt_PVHV) {
-	SV *sv = perl_hvrv_magic_obj(rv);
-	if(!sv) croak("HV is not magic!");
-	return (table *)SvIV((SV*)SvRV(sv));
-    }
-    return (table *)SvIV((SV*)SvRV(rv));
+    if(tmp_arena_on)
+	tmp_release(PERL_TMP_KEEP);
 }
 
-static char *r_keys[] = { "_r", "r", NULL };
-
-static request_rec *r_magic_get(SV *sv)
+SV *mod_perl_tmp_stats(void)
 {
-    MAGIC *mg  = mg_find(sv, '~');
-    return mg ? (request_rec *)mg->mg_ptr : NULL;
+    HV *hv = newHV();
+    int i, cached = 0;
+
+    for(i=0; i<PERL_TMP_LISTS; i++)
+	cached += tmp_lists[i].cached;
+
+    hv_store(hv, "hits",     4, newSViv(tmp_stats.hits), FALSE);
+    hv_store(hv, "misses",   6, newSViv(tmp_stats.misses), FALSE);
+    hv_store(hv, "released", 8, newSViv(tmp_stats.released), FALSE);
+    hv_store(hv, "cached",   6, newSViv(cached), FALSE);
+
+    return newRV_noinc((SV*)hv);
 }
 
-request_rec *sv2request_rec(SV *in, char *pclass, CV *cv)
+/*
+ * access log records written from C in the log phase, see
+ * Apache->access_log.  records are appended to a per-child buffer and
+ * written with a single write() when it fills up, when a record is
+ * added PERL_ACCESS_LOG_SECS or more after the oldest one, and when
+ * the child exits.  the buffer only ever holds whole records, so
+ * children sharing the file (opened O_APPEND in the parent) do not
+ * interleave them.  if a write() stops part way through a record, the
+ * next batch starts with a new header, for the reader to resync on.
+ * text records are tab separated values ending in a newline, binary
+ * records are a 4 byte length followed by each value as a 2 byte length
+ * and its bytes, all in network order.  a header naming the fields is
+ * written each time the log is opened
+ */
+#ifndef PERL_ACCESS_LOG_BUFSIZE
+#define PERL_ACCESS_LOG_BUFSIZE (32*1024)
+#endif
+#ifndef PERL_ACCESS_LOG_SECS
+#define PERL_ACCESS_LOG_SECS 2
+#endif
+#define PERL_ACCESS_LOG_MAGIC "MPAL\001"
+
+enum {
+    ALOG_TIME, ALOG_DURATION, ALOG_STATUS, ALOG_BYTES, ALOG_METHOD,
+    ALOG_URI, ALOG_ARGS, ALOG_PROTOCOL, ALOG_REQUEST, ALOG_FILENAME,
+    ALOG_HOST, ALOG_USER, ALOG_VHOST, ALOG_PID,
+    ALOG_HEADER_IN, ALOG_HEADER_OUT, ALOG_NOTE, ALOG_ENV
+};
+
+static struct {
+    char *name;
+    int type;
+} alog_names[] = {
+    {"time", ALOG_TIME}, {"duration", ALOG_DURATION},
+    {"status", ALOG_STATUS}, {"bytes", ALOG_BYTES},
+    {"method", ALOG_METHOD}, {"uri", ALOG_URI}, {"args", ALOG_ARGS},
+    {"protocol", ALOG_PROTOCOL}, {"request", ALOG_REQUEST},
+    {"filename", ALOG_FILENAME}, {"host", ALOG_HOST}, {"user", ALOG_USER},
+    {"vhost", ALOG_VHOST}, {"pid", ALOG_PID},
+    {"header_in:", ALOG_HEADER_IN}, {"header_out:", ALOG_HEADER_OUT},
+    {"note:", ALOG_NOTE}, {"env:", ALOG_ENV},
+    {NULL, 0}
+};
+
+typedef struct {
+    int type;
+    char *arg;
+} alog_field;
+
+static int alog_fd = -1, alog_binary = 0, alog_nfields = 0;
+static alog_field *alog_fields = NULL;
+static char alog_buf[PERL_ACCESS_LOG_BUFSIZE];
+static int alog_len = 0, alog_nrecs = 0; /* records in alog_buf */
+static time_t alog_since = 0;
+static pid_t alog_pid = 0;
+static int alog_torn = 0; /* a record was only partly written */
+static int alog_hdrlen = 0; /* of a header starting alog_buf */
+static struct {
+    long records;
+    long writes;
+    long dropped;
+} alog_stats = {0, 0, 0};
+
+/*
+ * records in the buffer not completely written by the first done
+ * bytes, torn is set if those stop part way through a record
+ */
+static int alog_unwritten(int done, int *torn)
 {
-    request_rec *r = NULL;
-    SV *sv = Nullsv;
+    int n = 0, pos;
+
+    *torn = done > 0 && done != alog_hdrlen;
+    if(!alog_nrecs) /* only a header */
+	return 0;
+    if(alog_binary) {
+	for(pos = alog_hdrlen; pos < alog_len; ) {
+	    unsigned char *p = (unsigned char *)alog_buf + pos;
+	    pos += 4 + (int)(((unsigned long)p[0] << 24) | (p[1] << 16) |
+			     (p[2] << 8) | p[3]);
+	    if(pos == done)
+		*torn = 0;
+	    else if(pos > done)
+		n++;
+	}
+    }
+    else {
+	if(done > alog_hdrlen)
+	    *torn = alog_buf[done-1] != '\n';
+	else
+	    done = alog_hdrlen;
+	for(pos = done; pos < alog_len; pos++)
+	    if(alog_buf[pos] == '\n')
+		n++;
+    }
+    return n;
+}
 
-    if(in == &sv_undef) return NULL;
+void mod_perl_access_log_flush(void)
+{
+    if(alog_len && (alog_pid == getpid())) {
+	int done = 0, n;
 
-    if(SvROK(in) && (SvTYPE(SvRV(in)) == SVt_PVHV)) {
-	int i;
-	for (i=0; r_keys[i]; i++) {
-	    int klen = strlen(r_keys[i]);
-	    if(hv_exists((HV*)SvRV(in), r_keys[i], klen) &&
-	       (sv = *hv_fetch((HV*)SvRV(in), 
-			       r_keys[i], klen, FALSE))) {
-                if (SvROK(sv) && (SvTYPE(SvRV(sv)) == SVt_PVHV)) {
-                    /* dig deeper */
-                    return sv2request_rec(sv, pclass, cv);
-                }
+	while(done < alog_len) {
+	    if((n = write(alog_fd, alog_buf + done, alog_len - done)) < 0 &&
+	       errno == EINTR)
+		continue;
+	    if(n <= 0)
 		break;
-            }
+	    done += n;
 	}
-	if(!sv)
-	    croak("method `%s' invoked by a `%s' object with no `r' key!",
-		  GvNAME(CvGV(cv)), HvNAME(SvSTASH(SvRV(in))));
+	if(done < alog_len)
+	    alog_stats.dropped += alog_unwritten(done, &alog_torn);
+	alog_stats.writes++;
     }
+    alog_len = alog_nrecs = alog_hdrlen = 0;
+}
 
-    if(!sv) sv = in;
-    if(SvROK(sv) && (SvTYPE(SvRV(sv)) == SVt_PVMG)) {
-	if(sv_derived_from(sv, pclass)) {
-	    if((r = r_magic_get(SvRV(sv)))) {
-		/* ~ magic */
-	    }
-	    else {
-		r = (request_rec *) SvIV((SV*)SvRV(sv));
-	    }
+static int alog_put(char *rec, int len, const char *val)
+{
+    int vlen = val ? strlen(val) : 0;
+
+    if(alog_binary) {
+	if(vlen > 0xffff) vlen = 0xffff;
+	if(len + 2 + vlen > PERL_ACCESS_LOG_BUFSIZE - 1)
+	    return -1;
+	rec[len++] = (vlen >> 8) & 0xff;
+	rec[len++] = vlen & 0xff;
+	Copy(val, rec + len, vlen, char);
+	return len + vlen;
+    }
+
+    if(!vlen) {
+	val = "-";
+	vlen = 1;
+    }
+    /* worst case every byte escaped, plus the separator */
+    if(len + (vlen * 2) + 1 > PERL_ACCESS_LOG_BUFSIZE - 1)
+	return -1;
+    if(len)
+	rec[len++] = '\t';
+    for(; *val; val++) {
+	switch(*val) {
+	  case '\t': rec[len++] = '\\'; rec[len++] = 't'; break;
+	  case '\n': rec[len++] = '\\'; rec[len++] = 'n'; break;
+	  case '\\': rec[len++] = '\\'; rec[len++] = '\\'; break;
+	  default:   rec[len++] = *val;
 	}
-	else {
-	    return NULL;
+    }
+    return len;
+}
+
+/*
+ * whole record into the buffer, binary records start with room for
+ * the length, text records have room for the newline
+ */
+static void alog_header(int torn);
+
+static void alog_append(char *rec, int len)
+{
+    if(alog_binary) {
+	unsigned long n = len - 4;
+	rec[0] = (n >> 24) & 0xff;
+	rec[1] = (n >> 16) & 0xff;
+	rec[2] = (n >> 8) & 0xff;
+	rec[3] = n & 0xff;
+    }
+    else
+	rec[len++] = '\n';
+
+    if(alog_len + len > PERL_ACCESS_LOG_BUFSIZE)
+	mod_perl_access_log_flush();
+    if(!alog_len) {
+	alog_since = time(NULL);
+	alog_pid = getpid();
+	if(alog_torn) {
+	    alog_header(TRUE);
+	    if(alog_len + len > PERL_ACCESS_LOG_BUFSIZE)
+		mod_perl_access_log_flush();
 	}
     }
-    else if((r = perl_request_rec(NULL))) {
-	/*ok*/
-    } 
+    Copy(rec, alog_buf + alog_len, len, char);
+    alog_len += len;
+}
+
+/*
+ * the header naming the fields, at the start of the log and after a
+ * torn write, where a text header also ends the partial line
+ */
+static void alog_header(int torn)
+{
+    char rec[PERL_ACCESS_LOG_BUFSIZE];
+    int i, len;
+
+    alog_torn = 0;
+    if(alog_binary) {
+	len = sizeof(PERL_ACCESS_LOG_MAGIC) - 1;
+	Copy(PERL_ACCESS_LOG_MAGIC, alog_buf + alog_len, len, char);
+	alog_len += len;
+	len = 4;
+    }
     else {
-	croak("Apache->%s called without setting Apache->request!",
-	      GvNAME(CvGV(cv)));
+	if(torn)
+	    alog_buf[alog_len++] = '\n';
+	len = alog_put(rec, 0, "#fields:");
     }
-    return r;
+    for(i=0; i<alog_nfields && len >= 0; i++) {
+	alog_field *f = &alog_fields[i];
+	int j;
+	for(j=0; alog_names[j].type != f->type; j++)
+	    ;
+	len = alog_put(rec, len, *f->arg ?
+		       form("%s%s", alog_names[j].name, f->arg) :
+		       alog_names[j].name);
+    }
+    if(len >= 0)
+	alog_append(rec, len);
+    alog_hdrlen = alog_len;
 }
 
-pool *perl_get_util_pool(void)
+static const char *alog_value(request_rec *r, alog_field *f, char *num)
 {
-    request_rec *r = NULL;
-
-    if((r = perl_request_rec(NULL)))
-        return r->pool;
-    else
-        return perl_get_startup_pool();
+    request_rec *last = r;
+    const char *val;
+
+    while(last->next)
+	last = last->next;
+
+    switch(f->type) {
+      case ALOG_TIME:
+	sprintf(num, "%ld", (long)r->request_time);
+	return num;
+      case ALOG_DURATION:
+	sprintf(num, "%ld", (long)(time(NULL) - r->request_time));
+	return num;
+      case ALOG_STATUS:
+	sprintf(num, "%d", last->status);
+	return num;
+      case ALOG_BYTES:
+	sprintf(num, "%ld", (long)last->bytes_sent);
+	return num;
+      case ALOG_PID:
+	sprintf(num, "%ld", (long)getpid());
+	return num;
+      case ALOG_METHOD:   return r->method;
+      case ALOG_URI:      return r->uri;
+      case ALOG_ARGS:     return r->args;
+      case ALOG_PROTOCOL: return r->protocol;
+      case ALOG_REQUEST:  return r->the_request;
+      case ALOG_FILENAME: return last->filename;
+      case ALOG_HOST:     return r->connection->remote_ip;
+      case ALOG_USER:     return r->connection->user;
+      case ALOG_VHOST:    return r->server->server_hostname;
+      case ALOG_HEADER_IN:
+	return table_get(r->headers_in, f->arg);
+      case ALOG_HEADER_OUT:
+	if((val = table_get(last->headers_out, f->arg)))
+	    return val;
+	return table_get(last->err_headers_out, f->arg);
+      case ALOG_NOTE:
+	return table_get(last->notes, f->arg);
+      case ALOG_ENV:
+	return table_get(last->subprocess_env, f->arg);
+    }
     return NULL;
 }
 
-pool *perl_get_startup_pool(void)
+void mod_perl_access_log(request_rec *r)
 {
-    SV *sv = perl_get_sv("Apache::__POOL", FALSE);
-    if(sv) {
-	IV tmp = SvIV((SV*)SvRV(sv));
-	return (pool *)tmp;
+    char rec[PERL_ACCESS_LOG_BUFSIZE], num[32];
+    int i, len = alog_binary ? 4 : 0;
+
+    for(i=0; i<alog_nfields; i++) {
+	int n = alog_put(rec, len, alog_value(r, &alog_fields[i], num));
+	if(n < 0) {
+	    alog_stats.dropped++;
+	    return;
+	}
+	len = n;
     }
-    return NULL;
+
+    alog_append(rec, len);
+    alog_nrecs++;
+    alog_stats.records++;
+
+    if((time(NULL) - alog_since) >= PERL_ACCESS_LOG_SECS)
+	mod_perl_access_log_flush();
 }
 
-server_rec *perl_get_startup_server(void)
+/*
+ * open file, appending, for records of the named fields, returns NULL
+ * or an error message
+ */
+char *mod_perl_access_log_open(char *file, int binary, char **names, int n)
 {
-    SV *sv = perl_get_sv("Apache::__SERVER", FALSE);
-    if(sv) {
-	IV tmp = SvIV((SV*)SvRV(sv));
-	return (server_rec *)tmp;
+    int i, j;
+    alog_field *fields;
+
+    if(n <= 0)
+	return "no fields given";
+
+    fields = (alog_field *)safemalloc(sizeof(alog_field) * n);
+    for(i=0; i<n; i++) {
+	for(j=0; alog_names[j].name; j++) {
+	    char *name = alog_names[j].name;
+	    int nlen = strlen(name);
+	    if(name[nlen-1] == ':' ? 
+	       (strnEQ(names[i], name, nlen) && names[i][nlen]) :
+	       strEQ(names[i], name))
+		break;
+	}
+	if(!alog_names[j].name) {
+	    static char errmsg[MAX_STRING_LEN];
+	    ap_snprintf(errmsg, sizeof(errmsg),
+			"unknown access log field `%s'", names[i]);
+	    while(--i >= 0)
+		Safefree(fields[i].arg);
+	    safefree(fields);
+	    return errmsg;
+	}
+	fields[i].type = alog_names[j].type;
+	fields[i].arg = savepv(strchr(names[i], ':') ? 
+			       strchr(names[i], ':') + 1 : "");
     }
+
+    mod_perl_access_log_close();
+    if((alog_fd = open(file, O_WRONLY|O_APPEND|O_CREAT, 0644)) < 0) {
+	for(i=0; i<n; i++)
+	    Safefree(fields[i].arg);
+	safefree(fields);
+	return "could not open access log";
+    }
+    alog_fields = fields;
+    alog_nfields = n;
+    alog_binary = binary;
+
+    alog_pid = getpid();
+    alog_header(FALSE);
+    mod_perl_access_log_flush();
+
     return NULL;
 }
 
-void mod_perl_untaint(SV *sv)
+void mod_perl_access_log_close(void)
 {
-    if(!tainting) return;
-    if (SvTYPE(sv) >= SVt_PVMG && SvMAGIC(sv)) {
-	MAGIC *mg = mg_find(sv, 't');
-	if (mg)
-	    mg->mg_len &= ~1;
-    }
+    int i;
+
+    if(alog_fd < 0)
+	return;
+
+    mod_perl_access_log_flush();
+    close(alog_fd);
+    alog_fd = -1;
+    for(i=0; i<alog_nfields; i++)
+	Safefree(alog_fields[i].arg);
+    safefree(alog_fields);
+    alog_fields = NULL;
+    alog_nfields = 0;
 }
 
-/* same as Symbol::gensym() */
-SV *mod_perl_gensym (char *pack)
+int mod_perl_access_log_enabled(void)
 {
-    GV *gv = newGVgen(pack);
-    SV *rv = newRV((SV*)gv);
-    (void)hv_delete(gv_stashpv(pack, TRUE), 
-		    GvNAME(gv), GvNAMELEN(gv), G_DISCARD);
-    return rv;
+    return alog_fd >= 0;
 }
 
-SV *mod_perl_slurp_filename(request_rec *r)
+SV *mod_perl_access_log_stats(void)
 {
-    dTHR;
-    PerlIO *fp;
-    SV *insv;
+    HV *hv = newHV();
 
-    ENTER;
-    save_item(rs);
-    sv_setsv(rs, &sv_undef); 
+    hv_store(hv, "records", 7, newSViv(alog_stats.records), FALSE);
+    hv_store(hv, "writes",  6, newSViv(alog_stats.writes), FALSE);
+    hv_store(hv, "dropped", 7, newSViv(alog_stats.dropped), FALSE);
 
-    fp = PerlIO_open(r->filename, "r");
-    insv = newSV(r->finfo.st_size);
-    sv_gets(insv, fp, 0); /*slurp*/
-    PerlIO_close(fp);
-    LEAVE;
-    return newRV_noinc(insv);
+    return newRV_noinc((SV*)hv);
 }
 
 SV *mod_perl_tie_table(table *t)
@@ -378,24 +1838,12 @@ void perl_stash_rgy_endav(char *s, SV *rgystash)
 	hv_store(mod_perl_endhv, key, klen, (SV*)newRV((SV*)rgyendav), FALSE);
 }
 
-void perl_run_rgy_endav(char *s) 
+static void run_rgy_endav(char *key, STRLEN klen, char *s)
 {
-    SV *rgystash = perl_get_sv("Apache::Registry::curstash", FALSE);
     AV *rgyendav = Nullav;
-    STRLEN klen;
-    char *key;
     dTHR;
 
-    if(!rgystash || !SvTRUE(rgystash)) {
-	MP_TRACE_g(fprintf(stderr, 
-        "Apache::Registry::curstash not set, can't run END blocks for %s\n",
-			 s));
-	return;
-    }
-
-    key = SvPV(rgystash,klen);
-
-    if(hv_exists(mod_perl_endhv, key, klen)) {
+    if(mod_perl_endhv && hv_exists(mod_perl_endhv, key, klen)) {
 	SV *entry = *hv_fetch(mod_perl_endhv, key, klen, FALSE);
 	if(SvTRUE(entry) && SvROK(entry)) 
 	    rgyendav = (AV*)SvRV(entry);
@@ -408,9 +1856,42 @@ void perl_run_rgy_endav(char *s)
     if((endav = rgyendav)) 
 	perl_run_blocks(scopestack_ix, endav);
     LEAVE;
+}
+
+void perl_run_rgy_endav(char *s) 
+{
+    SV *rgystash = perl_get_sv("Apache::Registry::curstash", FALSE);
+    STRLEN klen;
+    char *key;
+
+    if(!rgystash || !SvTRUE(rgystash)) {
+	MP_TRACE_g(fprintf(stderr, 
+        "Apache::Registry::curstash not set, can't run END blocks for %s\n",
+			 s));
+	return;
+    }
+
+    key = SvPV(rgystash,klen);
+    run_rgy_endav(key, klen, s);
     sv_setpv(rgystash,"");
 }
 
+/* run and forget the END blocks stashed for a script that is being
+ * dropped from the registry cache, the script is not going to be
+ * compiled again (unless requested), so the blocks must not linger
+ */
+void mod_perl_run_rgy_endav(request_rec *r, SV *sv)
+{
+    STRLEN klen;
+    char *key;
+
+    if(!sv || !SvTRUE(sv)) return;
+
+    key = SvPV(sv,klen);
+    run_rgy_endav(key, klen, r->uri);
+    mod_perl_clear_rgy_endav(r, sv);
+}
+
 void perl_run_endav(char *s)
 {
     dTHR;
@@ -537,16 +2018,129 @@ SV *perl_module2file(char *name)
     return sv;
 }
 
+/*
+ * with MOD_PERL_COW_REPORT set in the environment, the heap each
+ * PerlModule/PerlRequire grew in the parent is remembered, so children
+ * can tell (via /proc/self/pagemap) how much of it is no longer shared.
+ * the range between the break before and after the load is only an
+ * approximation, allocations which reuse freed memory or are large
+ * enough for malloc to mmap them are not seen
+ */
+#ifdef __linux__
+typedef struct {
+    char *name;
+    char *start, *end;
+} cow_range;
+
+static cow_range *cow_ranges = NULL;
+static int cow_nranges = 0, cow_on = -1;
+
+static char *cow_start(void)
+{
+    if(cow_on == -1)
+	cow_on = getenv("MOD_PERL_COW_REPORT") ? 1 : 0;
+    return cow_on ? (char *)sbrk(0) : NULL;
+}
+
+static void cow_end(char *name, char *start)
+{
+    char *end;
+
+    if(!start || ((end = (char *)sbrk(0)) <= start))
+	return;
+
+    cow_ranges = (cow_range *)realloc(cow_ranges,
+				      sizeof(cow_range) * (cow_nranges+1));
+    cow_ranges[cow_nranges].name = strdup(name);
+    cow_ranges[cow_nranges].start = start;
+    cow_ranges[cow_nranges].end = end;
+    MP_TRACE_d(fprintf(stderr, "%s grew the heap by %d bytes\n",
+		       name, (int)(end - start)));
+    cow_nranges++;
+}
+
+static void cow_cleanup(void)
+{
+    int i;
+    for(i=0; i<cow_nranges; i++)
+	free(cow_ranges[i].name);
+    free(cow_ranges);
+    cow_ranges = NULL;
+    cow_nranges = 0;
+}
+
+#define PM_PRESENT(e)   ((e) & ((U64TYPE)1 << 63))
+#define PM_EXCLUSIVE(e) ((e) & ((U64TYPE)1 << 56))
+
+/*
+ * returns an array ref of [name, size, resident, private] for each
+ * recorded module load, in KB, private pages are the ones this process
+ * has its own copy of.  empty if nothing was recorded or pagemap is not
+ * readable
+ */
+SV *mod_perl_cow_report(void)
+{
+    AV *av = newAV();
+    U64TYPE ent[512];
+    long pagesize = getpagesize(), pagekb = pagesize / 1024;
+    int i, fd;
+
+    if(!cow_nranges || (fd = open("/proc/self/pagemap", O_RDONLY)) < 0)
+	return newRV_noinc((SV*)av);
+
+    for(i=0; i<cow_nranges; i++) {
+	unsigned long page = (unsigned long)cow_ranges[i].start / pagesize;
+	unsigned long last = ((unsigned long)cow_ranges[i].end - 1) / pagesize;
+	IV pages = last - page + 1, resident = 0, private = 0;
+	AV *row = newAV();
+
+	while(page <= last) {
+	    int j, n = last - page + 1;
+	    if(n > 512) n = 512;
+	    n = pread(fd, ent, n * sizeof(U64TYPE), 
+		      (off_t)page * sizeof(U64TYPE)) / (int)sizeof(U64TYPE);
+	    if(n <= 0) break;
+	    for(j=0; j<n; j++) {
+		if(!PM_PRESENT(ent[j])) continue;
+		resident++;
+		if(PM_EXCLUSIVE(ent[j])) private++;
+	    }
+	    page += n;
+	}
+
+	av_push(row, newSVpv(cow_ranges[i].name, 0));
+	av_push(row, newSViv(pages * pagekb));
+	av_push(row, newSViv(resident * pagekb));
+	av_push(row, newSViv(private * pagekb));
+	av_push(av, newRV_noinc((SV*)row));
+    }
+
+    close(fd);
+    return newRV_noinc((SV*)av);
+}
+#else
+#define cow_start() NULL
+#define cow_end(name, start)
+static void cow_cleanup(void) {}
+
+SV *mod_perl_cow_report(void)
+{
+    return newRV_noinc((SV*)newAV());
+}
+#endif
+
 int perl_require_module(char *name, server_rec *s)
 {
     dTHR;
     SV *sv = sv_newmortal();
+    char *cow = cow_start();
     dTHRCTX;
 
     sv_setpvn(sv, "require ", 8);
     MP_TRACE_d(fprintf(stderr, "loading perl module '%s'...", name)); 
     sv_catpv(sv, name);
     perl_eval_sv(sv, G_DISCARD);
+    cow_end(name, cow);
     if(s) {
 	if(perl_eval_ok(s) != OK) {
 	    MP_TRACE_d(fprintf(stderr, "not ok\n"));
@@ -576,6 +2170,7 @@ int perl_load_startup_script(server_rec *s, pool *p, char *script, U8 my_warn)
 {
     dTHR;
     U8 old_warn = dowarn;
+    char *cow;
 
     if(!script) {
 	MP_TRACE_d(fprintf(stderr, "no Perl script to load\n"));
@@ -585,7 +2180,9 @@ int perl_load_startup_script(server_rec *s, pool *p, char *script, U8 my_warn)
     MP_TRACE_d(fprintf(stderr, "attempting to require `%s'\n", script));
     dowarn = my_warn;
     curstash = defstash;
+    cow = cow_start();
     perl_do_file(script);
+    cow_end(script, cow);
     dowarn = old_warn;
     return perl_eval_ok(s);
 } 
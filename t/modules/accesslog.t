@@ -0,0 +1,10 @@
+use Apache::testold;
+
+my $url = "http://$net::httpserver$net::perldir/accesslog.pl";
+
+skip_test unless fetch("$url?open=text") =~ /^opened/;
+
+print "1..12\n";
+print fetch "$url?check=text";
+fetch("$url?open=binary");
+print fetch "$url?check=binary&n=6";
@@ -0,0 +1,3 @@
+use Apache::testold;
+
+print fetch "http://$net::httpserver$net::perldir/options.pl";
@@ -1,5 +1,5 @@
 
 use Apache::testold;
 
-print fetch "http://$net::httpserver$net::perldir/uri.pl";
+print fetch "http://$net::httpserver$net::perldir/uri.pl?b=2&a=1";
 
@@ -0,0 +1,43 @@
+#!perl
+use strict;
+use Apache::testold;
+
+my $r = shift;
+$r->send_http_header('text/plain');
+
+unless (Apache->can('access_log')) {
+    print "no access_log\n";
+    return;
+}
+require Apache::AccessLog;
+
+my %args = $r->args;
+my $fmt = $args{open} || $args{check};
+my $file = $r->server_root_relative("logs/accesslog.$fmt");
+my @fields = qw(uri args status note:x note:none);
+my $note = "a\tb\nc\\d";
+
+if ($args{open}) {
+    #this request is the one logged
+    unlink $file;
+    Apache->access_log($file, $fmt, @fields);
+    $r->notes(x => $note);
+    print "opened $fmt\n";
+    return;
+}
+
+Apache->access_log_flush;
+Apache->access_log;
+
+my $i = $args{n} || 0;
+my $log = Apache::AccessLog->new($file);
+my $rec = $log->next;
+unlink $file;
+
+test ++$i, join(" ", $log->fields) eq "@fields";
+test ++$i, $rec && $rec->{uri} eq $r->uri;
+test ++$i, $rec && $rec->{args} eq "open=$fmt";
+test ++$i, $rec && $rec->{status} == 200;
+test ++$i, $rec && $rec->{'note:x'} eq $note &&
+  !(defined $rec->{'note:none'} and length $rec->{'note:none'});
+test ++$i, !$log->next;
@@ -0,0 +1,16 @@
+#!perl
+use strict;
+use Apache::testold;
+use Apache::Options;
+
+my $r = shift;
+$r->send_http_header('text/plain');
+
+my $i = 0;
+print "1..3\n";
+
+test ++$i, defined &OPT_EXECCGI;
+test ++$i, OPT_EXECCGI() == Apache::Constants::OPT_EXECCGI() &&
+  OPT_INDEXES() == Apache::Constants::OPT_INDEXES();
+#the :options tag only, not :common
+test ++$i, !defined &OK;
@@ -30,7 +30,22 @@ port
 unparse
 };     
 
-my $tests = (@methods * 2) * 2; 
+my @paths = (
+    ["/a//b///c" => "/a/b/c"],
+    ["/a/./b/." => "/a/b/"],
+    ["/a/b/../c" => "/a/c"],
+    ["/a/b/.." => "/a/"],
+    ["/../../x" => "/x"],
+    ["/a/.b/..c/" => "/a/.b/..c/"],
+    ["/a/%2e%2E/b" => "/b"],
+    ["/%7euser/%2fx%3a" => "/~user/%2Fx%3A"],
+    ["//a/..//b" => "/b"],
+    ["/a/%2" => "/a/%2"],
+    ["/" => "/"],
+    ["" => ""],
+);
+
+my $tests = (@methods * 2) * 2 + 4 + @paths + 5;
 print "1..$tests\n";
 my $test_uri = "http://perl.apache.org:80/dist/apache-modlist.html";
 
@@ -45,3 +60,51 @@ for (1,2) {
 	}
     }
 }
+
+my $uri = Apache::URI->parse($r, $test_uri);
+my %parts = $uri->components;
+test ++$i, $parts{hostname} eq $uri->hostname and $parts{port} == 80 and
+  $parts{path} eq "/dist/apache-modlist.html" and !defined $parts{query};
+
+my $same = $uri->parse($r, "https://www.apache.org/foo?bar");
+test ++$i, $same == $uri and $uri->scheme eq "https" and
+  $uri->query eq "bar" and $uri->path eq "/foo";
+
+my $old = $uri->path("/baz");
+test ++$i, $old eq "/foo" and $uri->path eq "/baz" and
+  $uri->unparse eq "https://www.apache.org/baz?bar";
+
+#each value is a copy, changing it leaves the object alone
+my $changed = eval { for ($uri->path) { s/baz/qux/ } 1 };
+test ++$i, $changed and $uri->path eq "/baz" and
+  Apache::unescape_url($uri->path) eq "/baz";
+
+for (@paths) {
+    my($path, $want) = @$_;
+    my $copy = $path;
+    my $got = Apache::URI::normalize_path($copy);
+    test ++$i, $got eq $want && $copy eq $want;
+    print "normalize_path `$path' = `$got'\n";
+}
+
+test ++$i, Apache::URI::normalize_path(my $p = "/a//./b", "dots") eq "/a//b";
+
+$uri = Apache::URI->parse($r, "HTTP://Perl.Apache.ORG:80//dist/./x/../mod.html?b=2&a=1");
+$uri->canonical;
+test ++$i, $uri->unparse eq "http://perl.apache.org/dist/mod.html?b=2&a=1" and
+  $uri->hostname eq "perl.apache.org" and !defined $uri->port;
+print "canonical = ", $uri->unparse, "\n";
+
+$uri->canonical("query");
+test ++$i, $uri->query eq "a=1&b=2";
+
+#the request's own uri and args are left alone
+my($r_uri, $r_args) = ($r->uri, scalar $r->args);
+$r->parsed_uri->canonical("query");
+$r->parsed_uri->canonical;
+test ++$i, $r->uri eq $r_uri and scalar($r->args) eq $r_args;
+print "uri = ", $r->uri, ", args = ", scalar($r->args), "\n";
+
+$uri = Apache::URI->parse($r, "http://perl.apache.org:8080/a//b");
+test ++$i, $uri->canonical("port", "host")->unparse eq
+  "http://perl.apache.org:8080/a//b";
@@ -3,7 +3,7 @@ use strict;
 use Apache::testold;
 $|++;
 my $i = 0;
-my $tests = 9;
+my $tests = 21;
 
 my $r = shift;
 $r->send_http_header('text/plain');
@@ -83,6 +83,37 @@ timethese(1000, {
 });
 =cut
 
+my $long = ("x" x 37) . qq(<a href="?a=1&b=2">) . ("y" x 20) . "&";
+my $elong = Apache::Util::escape_html($long);
+test ++$i, $elong eq HTML::Entities::encode($long);
+
+my $out = "reused";
+Apache::Util::escape_html($long, $out);
+test ++$i, $out eq $elong;
+
+my $inplace = $long;
+Apache::Util::escape_html($inplace, $inplace);
+test ++$i, $inplace eq $elong;
+
+{
+    my $warned = 0;
+    local $SIG{__WARN__} = sub { $warned++ };
+    local $^W = 1;
+    my $fresh;
+    Apache::Util::escape_html($long, $fresh);
+    test ++$i, !$warned && $fresh eq $elong;
+}
+
+if ($] >= 5.008) {
+    #a character string stays one
+    my $u = eval q{"\x{263a}<"};
+    Apache::Util::escape_html($u, $u);
+    test ++$i, $u eq eval q{"\x{263a}&lt;"};
+}
+else {
+    test ++$i, 1;
+}
+
 my $uri = "http://www.apache.org/docs/mod/mod_proxy.html?has some spaces";
 
 my $C = Apache::Util::escape_uri($uri);
@@ -110,6 +141,19 @@ timethese(10000, {
         print "received: $received\n";
     }
 
+    {
+        my $str = "a%2Fb%zz+c%41";
+        my $received = Apache::unescape_url($str);
+        test ++$i, $received eq "a/b%zz+cA" and $str eq $received;
+        print "received: $received\n";
+    }
+
+    {
+        my $received = Apache::Util::escape_uri("a b/\x{e9}%");
+        test ++$i, $received eq "a%20b/%e9%25";
+        print "received: $received\n";
+    }
+
     {
         my $str = undef;
         my $expected = "";
@@ -120,6 +164,29 @@ timethese(10000, {
         print "received: $received\n";
     }
 
+{
+    my $bin = join "", map { chr } 0..255;
+    my $b64 = Apache::Util::encode_base64($bin);
+    my $url = Apache::Util::encode_base64url($bin);
+    test ++$i, Apache::Util::decode_base64($b64) eq $bin and
+      Apache::Util::decode_base64($url) eq $bin and
+      Apache::Util::encode_base64("dougm:foo") eq "ZG91Z206Zm9v" and
+      !defined Apache::Util::decode_base64("ZG91*") and
+      !defined Apache::Util::decode_base64("Zg==garbage") and
+      Apache::Util::decode_base64("Zg==\n") eq "f";
+
+    my $hex = Apache::Util::encode_hex($bin);
+    test ++$i, $hex eq unpack("H*", $bin) and
+      Apache::Util::decode_hex(uc $hex) eq $bin;
+
+    my $qp = Apache::Util::encode_qp("caf\xe9 = ok \n" . ("x" x 100));
+    my $copy = $qp;
+    Apache::Util::decode_qp($copy, $copy);
+    test ++$i, $qp =~ /^caf=E9 =3D ok=20\n/ and
+      $copy eq "caf\xe9 = ok \n" . ("x" x 100);
+    print "qp = $qp\n";
+}
+
 $C = Apache::Util::ht_time();
 $Perl = HTTP::Date::time2str();
 my $builtin = scalar gmtime;
@@ -140,6 +207,16 @@ timethese(10000, {
 });  
 =cut
 
+{
+    my $now = time;
+    my $d = Apache::Util::ht_time($now);
+    my $out = "";
+    Apache::Util::ht_time($now, "%a, %d %b %Y %H:%M:%S %Z", 1, $out);
+    test ++$i, $d eq $out and
+      Apache::Util::ht_time($now + 1) ne $d;
+    print "out = $out\n";
+}
+
 my @formats = ("%d %b %Y %T %Z", "%a, %d %B %Y");
 
 if($test_date_format) {
@@ -175,6 +252,9 @@ Benchmark: timing 10000 iterations of C, Perl...
 my $date_str = "Sat, 18 Jul 1998 08:38:00 GMT";
 
 test ++$i, Apache::Util::parsedate($date_str);
+test ++$i, Apache::Util::parsedate($date_str) ==
+  Apache::Util::parsedate("Sat, 18 Jul 1998 08:38:00 GMT") and
+  !Apache::Util::parsedate("bogus") and !Apache::Util::parsedate("bogus");
 
 if($test_time_parsedate) {
     my $c = Apache::Util::parsedate($date_str);